@@ -0,0 +1,128 @@
+/**
+ * @file distance_kernel_bench.cpp
+ * @brief Microbenchmark: sweep candidate filtering with the legacy, scalar and AVX2 paths
+ *
+ * Builds a random X-sorted point set and, for every point, filters the candidates in its
+ * X window (as the plane sweep does). Reports time per candidate and checks that every
+ * path finds the same number of pairs.
+ *
+ * Usage: distance_kernel_bench [numPoints] [distance] [numFeatures] [repeats]
+ */
+
+#include "distance_kernel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+	struct Points {
+		std::vector<double> x, y;
+		std::vector<FeatureID> f;
+	};
+
+	// Uniform points in a square sized for about 20 candidates per X window, sorted by X
+	Points makePoints(size_t n, double distance, int numFeatures) {
+		std::mt19937_64 rng(42);
+		double side = std::max(distance, distance * static_cast<double>(n) / 20.0 / 2.0);
+		std::uniform_real_distribution<double> coord(0.0, side);
+		std::uniform_int_distribution<int> feature(0, numFeatures - 1);
+
+		std::vector<size_t> order(n);
+		std::vector<double> x(n), y(n);
+		std::vector<FeatureID> f(n);
+		for (size_t i = 0; i < n; ++i) {
+			x[i] = coord(rng);
+			y[i] = coord(rng);
+			f[i] = static_cast<FeatureID>(feature(rng));
+		}
+		std::iota(order.begin(), order.end(), size_t(0));
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return x[a] < x[b]; });
+
+		Points p;
+		for (size_t i : order) {
+			p.x.push_back(x[i]);
+			p.y.push_back(y[i]);
+			p.f.push_back(f[i]);
+		}
+		return p;
+	}
+
+	// Previous sweep inner loop: break on X gap, Y prefilter, pow/sqrt distance, feature compare
+	size_t legacySweep(const Points& p, double distance, size_t& candidates) {
+		size_t pairs = 0;
+		for (size_t i = 0; i < p.x.size(); ++i) {
+			for (size_t j = i + 1; j < p.x.size(); ++j) {
+				if (p.x[j] - p.x[i] > distance) break;
+				++candidates;
+				if (std::abs(p.y[j] - p.y[i]) <= distance) {
+					double dist = std::sqrt(std::pow(p.x[i] - p.x[j], 2) + std::pow(p.y[i] - p.y[j], 2));
+					if (dist <= distance && p.f[i] != p.f[j]) ++pairs;
+				}
+			}
+		}
+		return pairs;
+	}
+
+	// Sweep that hands each X window to a candidate filter
+	size_t kernelSweep(const Points& p, double distance, DistanceKernelFn kernel, size_t& candidates) {
+		double maxSquaredDist = squaredDistanceBound(distance);
+		std::vector<uint32_t> hits;
+		size_t pairs = 0;
+		size_t windowEnd = 0;
+		for (size_t i = 0; i < p.x.size(); ++i) {
+			windowEnd = std::max(windowEnd, i + 1);
+			while (windowEnd < p.x.size() && !(p.x[windowEnd] - p.x[i] > distance)) ++windowEnd;
+
+			size_t count = windowEnd - (i + 1);
+			candidates += count;
+			if (hits.size() < count) hits.resize(count);
+			pairs += kernel(p.x[i], p.y[i], p.f[i], &p.x[i + 1], &p.y[i + 1], &p.f[i + 1], count,
+				maxSquaredDist, hits.data());
+		}
+		return pairs;
+	}
+
+	template <typename Run>
+	void report(const std::string& name, int repeats, Run run) {
+		size_t pairs = 0, candidates = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; ++r) {
+			candidates = 0;
+			pairs = run(candidates);
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double nsPerCandidate = seconds * 1e9 / (static_cast<double>(candidates) * repeats);
+
+		std::cout << std::left << std::setw(10) << name
+			<< " pairs: " << std::setw(10) << pairs
+			<< " candidates: " << std::setw(12) << candidates
+			<< " time: " << std::fixed << std::setprecision(3) << seconds / repeats << " s"
+			<< "  (" << std::setprecision(2) << nsPerCandidate << " ns/candidate)\n";
+	}
+}
+
+int main(int argc, char* argv[]) {
+	size_t numPoints = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 200000;
+	double distance = (argc > 2) ? std::atof(argv[2]) : 100.0;
+	int numFeatures = (argc > 3) ? std::atoi(argv[3]) : 16;
+	int repeats = (argc > 4) ? std::atoi(argv[4]) : 5;
+
+	Points points = makePoints(numPoints, distance, numFeatures);
+	std::cout << "Points: " << numPoints << " | Distance: " << distance
+		<< " | Features: " << numFeatures << " | AVX2: " << (cpuSupportsAVX2() ? "yes" : "no") << "\n";
+
+	report("legacy", repeats, [&](size_t& c) { return legacySweep(points, distance, c); });
+	report("scalar", repeats, [&](size_t& c) { return kernelSweep(points, distance, &filterCandidatesScalar, c); });
+	if (cpuSupportsAVX2()) {
+		report("avx2", repeats, [&](size_t& c) { return kernelSweep(points, distance, &filterCandidatesAVX2, c); });
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+/**
+ * @file binary_io.h
+ * @brief Helpers shared by the mmap-friendly binary files (datasets, caches)
+ *
+ * Every array section starts on a kBinaryAlignment boundary, so once a file is mapped
+ * each array can be used in place through a borrowed Column.
+ */
+
+#pragma once
+#include "column.h"
+#include "mapped_file.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+/** @brief Alignment of every array section */
+constexpr uint64_t kBinaryAlignment = 64;
+
+/** @brief Written as-is by the producer; a reader with another byte order sees it swapped */
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+/** @brief Pad the stream with zeros to the next multiple of kBinaryAlignment; returns the new position */
+inline uint64_t alignStream(std::ofstream& out) {
+	static const char zeros[kBinaryAlignment] = {};
+	uint64_t position = static_cast<uint64_t>(out.tellp());
+	uint64_t padding = (kBinaryAlignment - position % kBinaryAlignment) % kBinaryAlignment;
+	out.write(zeros, static_cast<std::streamsize>(padding));
+	return position + padding;
+}
+
+/** @brief Write count values on an aligned boundary; returns their offset */
+template <typename T>
+uint64_t writeAlignedArray(std::ofstream& out, const T* values, size_t count) {
+	uint64_t offset = alignStream(out);
+	out.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+	return offset;
+}
+
+/**
+ * @brief Borrow count values of type T at offset of a mapped file
+ * @return false (column untouched) if the range is misaligned or runs past the file
+ */
+template <typename T>
+bool borrowArray(const MappedFile& file, uint64_t offset, uint64_t count, Column<T>& column) {
+	if (offset % alignof(T) != 0 || offset > file.size() || count > (file.size() - offset) / sizeof(T)) {
+		return false;
+	}
+	column = Column<T>::borrow(reinterpret_cast<const T*>(file.data() + offset), static_cast<size_t>(count));
+	return true;
+}
+
+/** @brief 16 lowercase hex digits of value (cache file names) */
+std::string hex64(uint64_t value);
+
+/**
+ * @brief Create target's directory and open a fresh temporary file next to target
+ * @return Path of the temporary file (out is not open on failure)
+ */
+std::string openTemporaryFor(const std::string& target, std::ofstream& out);
+
+/**
+ * @brief Move a fully written temporary file over target, so readers never map a partial file
+ * @return false (temporary removed) if the stream failed or the rename did
+ */
+bool commitTemporary(std::ofstream& out, const std::string& temporary, const std::string& target);
@@ -0,0 +1,39 @@
+/**
+ * @file bit_utils.h
+ * @brief Portable 64-bit word helpers (popcount, trailing zeros)
+ */
+
+#pragma once
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/** @brief Number of set bits in a 64-bit word */
+inline int popcount64(uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	return static_cast<int>(__popcnt64(word));
+#elif defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(word);
+#else
+	int count = 0;
+	for (; word != 0; word &= word - 1) ++count;
+	return count;
+#endif
+}
+
+/** @brief Index of the lowest set bit of a non-zero 64-bit word */
+inline int countTrailingZeros64(uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(word);
+#else
+	int index = 0;
+	while ((word & 1) == 0) { word >>= 1; ++index; }
+	return index;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+/**
+ * @file column.h
+ * @brief Owned-or-borrowed contiguous array used by the columnar stores
+ */
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+class MappedFile;
+
+/**
+ * @brief An array that either owns its values or views read-only memory kept alive
+ * elsewhere (e.g., a mapped file held by the containing struct)
+ *
+ * Reads work the same either way. The first mutable access to a borrowed column copies
+ * it into owned storage, so a view is never written through.
+ */
+template <typename T>
+class Column {
+private:
+	std::vector<T> owned;
+	const T* view = nullptr;   ///< Borrowed values (null when owned)
+	size_t viewSize = 0;
+
+	void detach() {
+		if (!view) return;
+		owned.assign(view, view + viewSize);
+		view = nullptr;
+		viewSize = 0;
+	}
+
+public:
+	Column() = default;
+
+	// View count values at values; the caller keeps that memory alive
+	static Column borrow(const T* values, size_t count) {
+		Column column;
+		column.view = values;
+		column.viewSize = count;
+		return column;
+	}
+
+	bool isBorrowed() const { return view != nullptr; }
+	size_t size() const { return view ? viewSize : owned.size(); }
+	bool empty() const { return size() == 0; }
+
+	const T* data() const { return view ? view : owned.data(); }
+	const T* begin() const { return data(); }
+	const T* end() const { return data() + size(); }
+	const T& operator[](size_t i) const { return data()[i]; }
+
+	T* data() { detach(); return owned.data(); }
+	T* begin() { return data(); }
+	T* end() { return data() + size(); }
+	T& operator[](size_t i) { detach(); return owned[i]; }
+
+	void push_back(const T& value) { detach(); owned.push_back(value); }
+	void resize(size_t count) { detach(); owned.resize(count); }
+	void assign(size_t count, const T& value) { view = nullptr; viewSize = 0; owned.assign(count, value); }
+	void reserve(size_t count) { detach(); owned.reserve(count); }
+};
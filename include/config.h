@@ -6,10 +6,12 @@
  */
 
 #pragma once
+#include "types.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <vector>
 
  /**
   * @brief Configuration structure for application settings
@@ -19,15 +21,27 @@
   */
 struct AppConfig {
     // I/O Settings
-    std::string datasetPath;    ///< Path to input CSV dataset file
+    std::string datasetPath;    ///< Path to input dataset (CSV, or binary from convert_dataset)
     std::string outputPath;     ///< Path to output results file
+    std::string graphCacheDir;  ///< Directory of cached neighbor graphs (empty = no cache)
+    std::string hashmapIndexDir; ///< Directory of instance hashmap indexes (empty = no index)
+    std::string streamSpillDir; ///< Where streaming ingest spills its tiles (empty = system temporary directory)
 
     // Algorithm Parameters
     double neighborDistance;    ///< Distance threshold for spatial neighbors
     double minPrev;            ///< Minimum prevalence threshold (0.0 to 1.0)
+    std::vector<double> minPrevList; ///< If non-empty, mine once and report every threshold in it (minPrev unused; not with topK)
     double minCondProb;        ///< Minimum conditional probability for rules (0.0 to 1.0)
+    int topK;                  ///< If > 0, report the k patterns with the highest weighted PI instead (minPrev unused, warned)
+    JoinMethod joinMethod;     ///< Spatial join engine for neighbor pairs ("sweep" or "grid")
+    int bitsetMaxVertices;     ///< BK subproblems with |P U X| up to this size use bitset BK (0 = off, max 256)
+    MiningEngine miningEngine; ///< Participation source while mining ("queue" or "zeta")
+    int participationCacheMB;  ///< Budget of the queue engine's parent participation cache (0 = off)
 
     // System Settings
+    int numThreads;            ///< Worker threads for parallel stages (0 = all hardware threads)
+    int streamMemoryMB;        ///< If > 0, stream the dataset through on-disk tiles within this budget, which
+                               ///< also caps the participation cache (the instance hashmap is not covered)
     bool debugMode;            ///< Enable debug output messages
 
     /**
@@ -39,9 +53,19 @@ struct AppConfig {
     AppConfig()
         : datasetPath("data/sample_data.csv"),
         outputPath("src/c++/output/rules.txt"),
+        graphCacheDir(""),
+        hashmapIndexDir(""),
+        streamSpillDir(""),
         neighborDistance(5.0),
         minPrev(0.6),
         minCondProb(0.5),
+        topK(0),
+        joinMethod(JoinMethod::PlaneSweep),
+        bitsetMaxVertices(256),
+        miningEngine(MiningEngine::Queue),
+        participationCacheMB(256),
+        numThreads(1),
+        streamMemoryMB(0),
         debugMode(false) {
     }
 };
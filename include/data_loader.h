@@ -5,7 +5,9 @@
 
 #pragma once
 #include "types.h"
+#include "instance_store.h"
 #include "csv.hpp"
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -25,9 +27,90 @@ public:
      * - LocX: X coordinate (double)
      * - LocY: Y coordinate (double)
      *
+     * Files with a plain comma-separated header holding these columns (X/Y are accepted
+     * for LocX/LocY) and no quoted fields take a fast path: the file is memory-mapped,
+     * split at line boundaries and parsed in parallel. Anything else goes through the
+     * general CSV reader.
+     *
      * @param filepath Path to the CSV file
-     * @return std::vector<SpatialInstance> Vector of loaded spatial instances
-     * @note Instance IDs are generated as: FeatureType + InstanceNumber (e.g., "A1", "B2")
+     * @param numThreads Parser threads for the fast path (<= 0 uses every hardware thread)
+     * @return InstanceStore Columnar store of the loaded instances, in file order
+     * @note Feature names are interned with IDs in ascending name order. Instance IDs
+     *       (FeatureType + InstanceNumber, e.g., "A1") are built on demand by InstanceStore.
+     */
+    static InstanceStore load_csv(const std::string& filepath, int numThreads = 1);
+
+    /**
+     * @brief Load a dataset in either format
+     *
+     * Files starting with the binary dataset magic go to load_binary, anything else to load_csv.
+     *
+     * @param filepath Path to the dataset
+     * @param numThreads Parser threads for CSV input
+     * @return InstanceStore Columnar store of the loaded instances, in file order
+     */
+    static InstanceStore load(const std::string& filepath, int numThreads = 1);
+
+    /**
+     * @brief Map a binary columnar dataset written by save_binary
+     *
+     * Nothing is parsed: after the header, dictionary and a range check of the feature
+     * columns, the store's columns borrow the mapped pages directly.
+     *
+     * @param filepath Path to the binary dataset
+     * @return InstanceStore Store whose columns view the mapping (kept alive by the store)
+     * @throws std::runtime_error if the file is not a valid binary dataset
      */
-    static std::vector<SpatialInstance> load_csv(const std::string& filepath);
+    static InstanceStore load_binary(const std::string& filepath);
+
+    /**
+     * @brief Write instances as a binary columnar dataset
+     *
+     * Layout (native little-endian): a fixed header, the feature dictionary (names in ID
+     * order), then the x, y, featureId, instanceNumber and featureRank columns, each
+     * starting on a 64-byte boundary so every column can be used in place once mapped.
+     *
+     * @param instances Finalized store (as returned by the loaders)
+     * @param filepath Output path
+     * @throws std::runtime_error if the file cannot be written
+     */
+    static void save_binary(const InstanceStore& instances, const std::string& filepath);
+
+    /** @brief Receives one batch of a streamed dataset */
+    using BatchVisitor = std::function<void(const InstanceStore& batch)>;
+
+    /**
+     * @brief Read a dataset in fixed-size batches without holding it in memory
+     *
+     * CSV files with the plain fixed-schema header (see load_csv) are read batchBytes at
+     * a time and parsed like the fast path; any other CSV goes through the general reader,
+     * batchBytes / 64 rows at a time. Binary datasets are read one slice of every column
+     * at a time. Only the current batch is kept.
+     *
+     * @param filepath Path to the dataset (CSV or binary)
+     * @param batchBytes Bytes read per batch
+     * @param features Dictionary the batches' feature IDs refer to; names are interned as
+     *        they appear and it is not finalized (IDs in first-seen order)
+     * @param visit Called with every batch, in file order; x, y, featureId and instanceNumber
+     *        are set (featureRank is not)
+     * @throws std::runtime_error if the file cannot be read or a row is malformed (quoted
+     *         fields are only accepted in files the general reader handles)
+     */
+    static void stream(const std::string& filepath, size_t batchBytes, FeatureDictionary& features, const BatchVisitor& visit);
+
+private:
+    // Fast path for the fixed schema; returns false (instances untouched) if the file needs the general reader
+    static bool loadMapped(const std::string& filepath, int numThreads, InstanceStore& instances);
+
+    // General path through csv::CSVReader (any delimiter, quoting, column order)
+    static InstanceStore loadWithReader(const std::string& filepath);
+
+    // Batched fixed-schema CSV; returns false (nothing visited) if the header needs the general reader
+    static bool streamFixedSchema(const std::string& filepath, size_t batchBytes, FeatureDictionary& features, const BatchVisitor& visit);
+
+    // Batched rows of the general CSV reader
+    static void streamWithReader(const std::string& filepath, size_t batchBytes, FeatureDictionary& features, const BatchVisitor& visit);
+
+    // Batched column slices of a binary dataset
+    static void streamBinary(const std::string& filepath, size_t batchBytes, FeatureDictionary& features, const BatchVisitor& visit);
 };
\ No newline at end of file
@@ -0,0 +1,52 @@
+/**
+ * @file distance_kernel.h
+ * @brief Vectorized candidate filtering for the neighbor join
+ *
+ * Tests one query point against a contiguous block of candidates using squared distances
+ * and the same-feature exclusion. An AVX2 implementation is used when the CPU supports it,
+ * otherwise a scalar loop; the choice is made once at runtime.
+ */
+
+#pragma once
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Candidate filter signature
+ *
+ * Writes to hits the block-relative positions k (ascending) of every candidate with
+ * fs[k] != qf and (xs[k] - qx)^2 + (ys[k] - qy)^2 <= maxSquaredDist, and returns how many
+ * were written. hits must have room for count entries.
+ */
+using DistanceKernelFn = size_t(*)(
+	double qx, double qy, FeatureID qf,
+	const double* xs, const double* ys, const FeatureID* fs, size_t count,
+	double maxSquaredDist, uint32_t* hits);
+
+// Portable scalar implementation
+size_t filterCandidatesScalar(
+	double qx, double qy, FeatureID qf,
+	const double* xs, const double* ys, const FeatureID* fs, size_t count,
+	double maxSquaredDist, uint32_t* hits);
+
+// AVX2 implementation (8 candidates per iteration); only call when cpuSupportsAVX2()
+size_t filterCandidatesAVX2(
+	double qx, double qy, FeatureID qf,
+	const double* xs, const double* ys, const FeatureID* fs, size_t count,
+	double maxSquaredDist, uint32_t* hits);
+
+// True if the AVX2 kernel was compiled in and the running CPU supports it
+bool cpuSupportsAVX2();
+
+// Best kernel for the running CPU
+DistanceKernelFn selectDistanceKernel();
+
+/**
+ * @brief Squared-distance bound equivalent to a Euclidean threshold
+ *
+ * Returns the largest double D such that std::sqrt(D) <= distanceThreshold, so that
+ * "dx*dx + dy*dy <= D" accepts exactly the pairs "std::sqrt(dx*dx + dy*dy) <= distanceThreshold"
+ * accepts, without computing a square root per candidate.
+ */
+double squaredDistanceBound(double distanceThreshold);
\ No newline at end of file
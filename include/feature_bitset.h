@@ -0,0 +1,117 @@
+/**
+ * @file feature_bitset.h
+ * @brief Fixed-width bitmask over interned feature IDs, used as the colocation key
+ *
+ * Bit f is set when feature ID f is part of the pattern. Because feature IDs follow
+ * name order (see FeatureDictionary::finalize), iterating the set bits ascending yields
+ * the pattern's feature names in sorted order. W words hold up to 64 * W features.
+ */
+
+#pragma once
+#include "bit_utils.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Widest mask (in words) the colocation code is instantiated for
+ * Dictionaries of up to 64, 128 or 256 features get a 1, 2 or 4-word mask; wider ones the
+ * first of 16, 64, 256 and 1024 words that fits, so a mask is at most 4x its dictionary.
+ * 1024 words hold every FeatureID.
+ */
+constexpr size_t kMaxMaskWords = 1024;
+
+template <size_t W>
+struct FeatureBitset {
+	uint64_t words[W] = {};
+
+	void set(size_t f) { words[f >> 6] |= uint64_t(1) << (f & 63); }
+	void reset(size_t f) { words[f >> 6] &= ~(uint64_t(1) << (f & 63)); }
+	bool test(size_t f) const { return (words[f >> 6] >> (f & 63)) & 1; }
+
+	// Number of features in the pattern
+	size_t count() const {
+		size_t total = 0;
+		for (size_t i = 0; i < W; ++i) total += static_cast<size_t>(popcount64(words[i]));
+		return total;
+	}
+
+	bool empty() const {
+		uint64_t any = 0;
+		for (size_t i = 0; i < W; ++i) any |= words[i];
+		return any == 0;
+	}
+
+	// True if every feature of this pattern is also in other
+	bool isSubsetOf(const FeatureBitset& other) const {
+		for (size_t i = 0; i < W; ++i) {
+			if (words[i] & ~other.words[i]) return false;
+		}
+		return true;
+	}
+
+	// True if any feature with ID greater than f is set
+	bool anyAbove(size_t f) const {
+		size_t w = f >> 6;
+		if ((f & 63) != 63 && (words[w] >> (f & 63) >> 1) != 0) return true;
+		for (size_t i = w + 1; i < W; ++i) {
+			if (words[i] != 0) return true;
+		}
+		return false;
+	}
+
+	// Call fn(featureId) for every feature, ascending
+	template <typename Fn>
+	void forEach(Fn&& fn) const {
+		for (size_t i = 0; i < W; ++i) {
+			for (uint64_t word = words[i]; word != 0; word &= word - 1) {
+				fn((i << 6) + static_cast<size_t>(countTrailingZeros64(word)));
+			}
+		}
+	}
+
+	bool operator==(const FeatureBitset& other) const {
+		for (size_t i = 0; i < W; ++i) {
+			if (words[i] != other.words[i]) return false;
+		}
+		return true;
+	}
+	bool operator!=(const FeatureBitset& other) const { return !(*this == other); }
+
+	// Numeric order of the mask (cheap total order for ordered containers)
+	bool operator<(const FeatureBitset& other) const {
+		for (size_t i = W; i-- > 0;) {
+			if (words[i] != other.words[i]) return words[i] < other.words[i];
+		}
+		return false;
+	}
+};
+
+/**
+ * @brief Lexicographic order of the sorted feature sequences of a and b
+ * Matches comparing the corresponding Colocation name vectors.
+ */
+template <size_t W>
+bool lexicographicLess(const FeatureBitset<W>& a, const FeatureBitset<W>& b) {
+	for (size_t i = 0; i < W; ++i) {
+		uint64_t diff = a.words[i] ^ b.words[i];
+		if (diff == 0) continue;
+
+		// Both agree below d; the side holding d is smaller unless the other side ends there
+		size_t d = (i << 6) + static_cast<size_t>(countTrailingZeros64(diff));
+		bool otherContinues = a.test(d) ? b.anyAbove(d) : a.anyAbove(d);
+		return a.test(d) ? otherContinues : !otherContinues;
+	}
+	return false;
+}
+
+/** @brief Hash of a FeatureBitset for unordered containers */
+struct FeatureBitsetHash {
+	template <size_t W>
+	size_t operator()(const FeatureBitset<W>& mask) const {
+		uint64_t h = 0x9E3779B97F4A7C15ull;
+		for (size_t i = 0; i < W; ++i) {
+			h ^= mask.words[i] + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+		}
+		return static_cast<size_t>(h ^ (h >> 32));
+	}
+};
@@ -0,0 +1,40 @@
+/**
+ * @file graph_cache.h
+ * @brief On-disk cache of neighbor graphs keyed by dataset content and neighbor distance
+ */
+
+#pragma once
+#include "types.h"
+#include "instance_store.h"
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Cache entry of one (dataset, distance) neighbor graph
+ *
+ * The key is the dataset's content hash (coordinates and feature IDs, see
+ * InstanceStore::contentHash), its instance count and the exact bits of the distance.
+ * It names the file and is repeated in its header; a file whose header does not match
+ * the key, or whose CSR arrays fail the structural checks, is treated as a miss, so an
+ * entry for other data is never used. A hit maps the file and the graph borrows its arrays.
+ */
+class GraphCache {
+private:
+	std::string path;          ///< Entry file for this key
+	uint64_t datasetHash;      ///< InstanceStore::contentHash of the dataset
+	uint64_t numInstances;     ///< Instance count of the dataset (= graph nodes)
+	uint64_t distanceBits;     ///< Bit pattern of the neighbor distance
+
+public:
+	// Key of the graph for instances at distanceThreshold, stored under directory
+	GraphCache(const std::string& directory, const InstanceStore& instances, double distanceThreshold);
+
+	// Entry file for this key
+	const std::string& filePath() const { return path; }
+
+	// Map the cached graph; false on a miss or an invalid entry (graph untouched)
+	bool load(CSRGraph& graph) const;
+
+	// Write graph as this key's entry (atomically, via a temporary file); false if it could not be written
+	bool store(const CSRGraph& graph) const;
+};
@@ -0,0 +1,49 @@
+/**
+ * @file hashmap_index.h
+ * @brief Persisted maximal-clique instance hashmap, keyed by dataset content and distance
+ */
+
+#pragma once
+#include "types.h"
+#include "instance_store.h"
+#include "utils.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Index file holding everything mining needs from the neighbor graph
+ *
+ * The instance hashmap (colocation keys with the per-feature instance sets of their
+ * cliques) and the pairwise participation table both depend only on the dataset and the
+ * neighbor distance, so a run that finds the index skips the join, clique enumeration
+ * and hashmap construction. The key is the same as GraphCache's: dataset content hash,
+ * instance count and the bits of the distance, in the file name and in the header.
+ *
+ * The file is flat: sorted key masks, per-key entry ranges, per-feature entries and one
+ * array each of sparse ranks and dense bitmap words, every section aligned for mmap.
+ * Loading maps it, checks it and rebuilds the InstanceHashMap with one copy per set.
+ */
+class HashmapIndex {
+private:
+	std::string path;                      ///< Index file for this key
+	uint64_t datasetHash;                  ///< InstanceStore::contentHash of the dataset
+	uint64_t numInstances;                 ///< Instance count of the dataset
+	uint64_t distanceBits;                 ///< Bit pattern of the neighbor distance
+	std::vector<int> featureCounts;        ///< Instances per feature ID (the universe of each set)
+
+public:
+	// Key of the index for instances at distanceThreshold, stored under directory
+	HashmapIndex(const std::string& directory, const InstanceStore& instances, double distanceThreshold);
+
+	// Index file for this key
+	const std::string& filePath() const { return path; }
+
+	// Read the hashmap and pairwise table; false on a miss or an invalid file (outputs untouched)
+	template <size_t W>
+	bool load(InstanceHashMap<W>& hashMap, PairwiseParticipation& pairwise) const;
+
+	// Write the index (atomically, via a temporary file); false if it could not be written
+	template <size_t W>
+	bool store(const InstanceHashMap<W>& hashMap, const PairwiseParticipation& pairwise) const;
+};
@@ -0,0 +1,68 @@
+/**
+ * @file instance_bitmap.h
+ * @brief Hybrid sparse/dense bitmap of participating instances of one feature
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Set of instances of one feature, addressed by their rank within the feature
+ *
+ * Small sets are a sorted array of ranks; once that array would take more memory than
+ * one bit per instance of the feature (universe), the set switches to a plain bitmap.
+ * Union is a merge or a word-wise OR and count is a popcount, instead of the
+ * red-black-tree inserts of std::set.
+ *
+ * add() may be called in any order and with duplicates; call compact() after the last
+ * add() before reading the set.
+ */
+class InstanceBitmap {
+private:
+	uint32_t universe = 0;            ///< Number of instances of the feature (ranks < universe)
+	bool dense = false;               ///< Representation in use
+	std::vector<uint32_t> ranks;      ///< Sparse: ranks (sorted and unique after compact())
+	std::vector<uint64_t> words;      ///< Dense: ceil(universe / 64) words
+	size_t compactAt = 16;            ///< Sparse: ranks.size() that triggers the next compact()
+
+	// Switch to the bitmap representation
+	void toDense();
+	// Switch if the sorted array is no smaller than the bitmap
+	void chooseRepresentation();
+
+public:
+	InstanceBitmap() = default;
+	explicit InstanceBitmap(uint32_t universe) : universe(universe) {}
+
+	// Add one rank (buffered while sparse)
+	void add(uint32_t rank);
+
+	// Sort and deduplicate buffered ranks, switching to dense if smaller
+	void compact();
+
+	// this |= other (both compacted, same universe)
+	void unionWith(const InstanceBitmap& other);
+
+	// Number of instances in the set
+	size_t count() const;
+
+	// True if the bitmap representation is in use
+	bool isDense() const { return dense; }
+
+	// Number of instances of the feature (ranks are below it)
+	uint32_t universeSize() const { return universe; }
+
+	// Serialized form of a compacted set: the sorted ranks (sparse) or the bitmap words (dense)
+	const std::vector<uint32_t>& sortedRanks() const { return ranks; }
+	const std::vector<uint64_t>& bitmapWords() const { return words; }
+
+	// Rebuild a compacted set from its serialized form (ranks sorted, unique and below universe;
+	// ceil(universe / 64) words)
+	static InstanceBitmap fromSortedRanks(uint32_t universe, const uint32_t* ranks, size_t count);
+	static InstanceBitmap fromBitmapWords(uint32_t universe, const uint64_t* words, size_t count);
+
+	// Bytes held by the set's buffers
+	size_t memoryBytes() const { return ranks.capacity() * sizeof(uint32_t) + words.capacity() * sizeof(uint64_t); }
+};
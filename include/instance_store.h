@@ -0,0 +1,76 @@
+/**
+ * @file instance_store.h
+ * @brief Columnar (structure-of-arrays) storage for spatial instances
+ *
+ * Coordinates and feature IDs are kept in contiguous arrays so the spatial join only
+ * touches the columns it needs. Feature names are interned once in a FeatureDictionary;
+ * instance names (e.g., "A1") are only materialized when a report asks for them.
+ * Columns either own their values or borrow them from a memory-mapped binary dataset.
+ */
+
+#pragma once
+#include "types.h"
+#include "column.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/**
+ * @brief Interned feature names
+ *
+ * Maps each distinct feature name to a dense FeatureID. After finalize() the IDs are
+ * assigned in ascending name order, so sorting IDs also sorts names.
+ */
+class FeatureDictionary {
+private:
+	std::vector<FeatureType> names;                     ///< FeatureID -> name
+	std::unordered_map<FeatureType, FeatureID> ids;     ///< name -> FeatureID
+
+public:
+	// Return the ID of a feature name, adding it if unseen
+	FeatureID intern(const FeatureType& name);
+
+	// Renumber IDs in ascending name order; returns the old -> new ID mapping
+	std::vector<FeatureID> finalize();
+
+	// Name of a feature ID
+	const FeatureType& name(FeatureID id) const { return names[id]; }
+
+	// Number of distinct features
+	size_t size() const { return names.size(); }
+};
+
+/**
+ * @brief Structure-of-arrays store of spatial instances
+ *
+ * Instance i is (x[i], y[i]) with feature featureId[i]; instanceNumber[i] is the value of
+ * the dataset's Instance column and is only used to build names for reports.
+ */
+struct InstanceStore {
+	Column<double> x;                       ///< X coordinates
+	Column<double> y;                       ///< Y coordinates
+	Column<FeatureID> featureId;            ///< Interned feature of each instance
+	Column<int> instanceNumber;             ///< Instance number within its feature
+	Column<uint32_t> featureRank;           ///< Position among the instances of the same feature (set by finalizeFeatures)
+	FeatureDictionary features;             ///< Feature names
+	std::shared_ptr<const MappedFile> backing;   ///< Mapping the borrowed columns point into (if any)
+
+	// Number of instances
+	size_t size() const { return x.size(); }
+
+	// Append one instance (feature name is interned)
+	void add(const FeatureType& feature, int number, double px, double py);
+
+	// Renumber feature IDs in ascending name order and assign featureRank (call once after loading)
+	void finalizeFeatures();
+
+	// 64-bit hash of the columns that determine the neighbor graph (coordinates and feature IDs)
+	uint64_t contentHash() const;
+
+	// Feature name of an instance
+	const FeatureType& featureName(InstanceIndex i) const { return features.name(featureId[i]); }
+
+	// Materialize the instance name (FeatureType + InstanceNumber, e.g., "A1")
+	InstanceID instanceName(InstanceIndex i) const;
+};
\ No newline at end of file
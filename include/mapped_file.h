@@ -0,0 +1,41 @@
+/**
+ * @file mapped_file.h
+ * @brief Read-only memory mapping of a whole file (POSIX mmap / Win32 file mapping)
+ */
+
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief A file mapped read-only into memory for the lifetime of the object
+ *
+ * Pages are loaded lazily by the OS, so mapping a large file costs nothing until its
+ * bytes are touched. An empty file maps to data() == nullptr and size() == 0.
+ */
+class MappedFile {
+public:
+	MappedFile() = default;
+
+	// Map the whole file; throws std::runtime_error if it cannot be opened or mapped
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data() const { return bytes; }
+	size_t size() const { return length; }
+
+private:
+	const char* bytes = nullptr;
+	size_t length = 0;
+#if defined(_WIN32)
+	void* fileHandle = nullptr;      ///< HANDLE of the open file
+	void* mappingHandle = nullptr;   ///< HANDLE of the file mapping object
+#endif
+
+	void release();
+};
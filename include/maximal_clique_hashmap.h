@@ -6,12 +6,25 @@
 #pragma once
 
 #include "types.h"
+#include "instance_store.h"
 #include <vector>
 #include <unordered_map>
 #include <map>
 #include <set>
+#include <functional>
 #include <queue>
 
+/**
+ * @brief Counters from the last clique enumeration
+ */
+struct BKStats {
+	uint64_t components = 0;          ///< Connected components with at least one edge
+	uint64_t subproblems = 0;         ///< Per-vertex BK subproblems solved (isolated vertices skipped)
+	uint64_t cliques = 0;             ///< Maximal cliques (size >= 2) reported
+	uint64_t scratchAllocations = 0;  ///< Heap growths of the BK scratch arenas (all workers)
+	uint64_t bitsetSubproblems = 0;   ///< Subproblems finished by the bitset kernel
+};
+
 /**
  * @brief Class for maximal clique-based hashmap construction
  */
@@ -20,12 +33,51 @@ private:
 	// Execute Bron-Kerbosch algorithm to find maximal cliques
 	// std::vector<std::vector<ColocationInstance>> executeDivBK(const std::vector<NeighborSet>& neighborSets);
 
+	int numThreads;          ///< Workers for the per-vertex BK subproblems
+	int bitsetMaxVertices;   ///< |P U X| at or below which a subproblem switches to bitset BK
+	BKStats stats;           ///< Counters from the last executeDivBK call
+
+	// Workers used by enumerateCliques (numThreads resolved against the hardware)
+	size_t workerCount() const;
+
 public:
-	std::vector<ColocationInstance> executeDivBK(const std::vector<NeighborSet>& neighborSets);
-	// Build hashmap: colocation -> feature -> instances
-	std::map<Colocation, std::map<FeatureType, std::set<const SpatialInstance*>>> buildInstanceHash(const std::vector<NeighborSet>& neighborSets);
+	/**
+	 * @brief Called once per maximal clique (size >= 2), possibly from several threads
+	 * The clique buffer is only valid during the call. workerId < number of workers, and
+	 * calls with the same workerId never overlap, so per-worker state needs no locking.
+	 */
+	using CliqueVisitor = std::function<void(const InstanceIndex* clique, size_t size, size_t workerId)>;
+
+	/** @brief Decides whether a clique is kept (called from the enumerating threads) */
+	using CliqueFilter = std::function<bool(const InstanceIndex* clique, size_t size)>;
+
+	// numThreads <= 0 uses every hardware thread; bitsetMaxVertices is capped at 256 (0 disables)
+	explicit MaximalCliqueHashmap(int numThreads = 1, int bitsetMaxVertices = 256);
+
+	// Stream every maximal clique (size >= 2) of the CSR neighbor graph to visit
+	void enumerateCliques(const CSRGraph& graph, const CliqueVisitor& visit);
+	// Enumerate maximal cliques (size >= 2) of the CSR neighbor graph into one vector
+	std::vector<ColocationInstance> executeDivBK(const CSRGraph& graph);
+	// Build hashmap: colocation -> feature -> instances (W words per key, 64 * W features)
+	template <size_t W>
+	InstanceHashMap<W> buildInstanceHash(
+		const CSRGraph& graph,
+		const InstanceStore& instances);
+	// Fold the cliques accepted by keep (all if empty) into hashMap; instance sets span
+	// featureCounts[f] ranks, so graphs over parts of a dataset can fill one map
+	template <size_t W>
+	void addInstanceHash(
+		const CSRGraph& graph,
+		const InstanceStore& instances,
+		const std::vector<int>& featureCounts,
+		const CliqueFilter& keep,
+		InstanceHashMap<W>& hashMap);
+
+	// Counters from the last clique enumeration
+	const BKStats& getStats() const { return stats; }
 
 	// Extract initial candidate colocations from hashmap
-	std::priority_queue<Colocation, std::vector<Colocation>, ColocationPriorityComp> extractInitialCandidates(
-		const std::map<Colocation, std::map<FeatureType, std::set<const SpatialInstance*>>>& hashMap);
+	template <size_t W>
+	CandidateQueue<W> extractInitialCandidates(
+		const InstanceHashMap<W>& hashMap);
 };
\ No newline at end of file
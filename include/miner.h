@@ -1,46 +1,161 @@
-/**
+﻿/**
  * @file miner.h
  * @brief Prevalent colocation pattern mining
  */
 
 #pragma once
 #include "types.h"
+#include "utils.h"
+#include "superset_index.h"
+#include "participation_table.h"
 #include <set>
 #include <map>
 #include <unordered_map>
 #include <queue>
 #include <unordered_map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+template <size_t W>
+class ParticipationCache;
 
 /**
  * @brief Class for mining prevalent colocation patterns
+ *
+ * Patterns are ColocationMask<W> keys; the methods are instantiated for W = 1, 2, 4, 16, 64,
+ * 256 and 1024 (see kMaxMaskWords).
+ * featureCounts is indexed by FeatureID. Candidates are always visited in the same
+ * order (or, in parallel mode, level by level with the same result); the engine only
+ * decides how their participating instances are obtained.
  */
 class Miner {
 private:
-	// Query instances of a colocation from hashmap
-	std::map<FeatureType, std::set<const SpatialInstance*>> queryInstances(
-		Colocation c,
-		const std::map<Colocation, std::map<FeatureType, std::set<const SpatialInstance*>>>& hashMap);
+	MiningEngine engine;   ///< Where participating instances come from
+	int numThreads;        ///< 1 = serial priority queue; otherwise level-wise on a pool (<= 0: all hardware threads)
+
+	size_t cacheBytes;     ///< Budget of the parent participation cache (queue engine; 0 = off)
+	const PairwiseParticipation* pairwise;   ///< Optional pairwise counts for cheap rejection (queue engine)
+
+	// Exactly one of index / table is set, depending on the engine; cache is optional
+	template <size_t W>
+	struct ParticipationSource {
+		std::unique_ptr<SupersetIndex<W>> index;
+		std::unique_ptr<ParticipationTable<W>> table;
+		std::unique_ptr<ParticipationCache<W>> cache;
+	};
+
+	// Build the participation structures the engine needs
+	template <size_t W>
+	ParticipationSource<W> buildSource(const InstanceHashMap<W>& hashMap, size_t numFeatures);
+
+	// Buffers reused across candidates (one per worker)
+	struct CandidateScratch {
+		std::vector<uint32_t> matches;
+		std::vector<uint32_t> participation;
+		FeatureInstances instances;   ///< Participating instances of the last candidate (queue engine)
+	};
+
+	// Weighted PI of c (participation from the index or the table)
+	template <size_t W>
+	double evaluateWeightedPI(
+		const ColocationMask<W>& c,
+		const ParticipationSource<W>& source,
+		const std::vector<int>& featureCounts,
+		const RareWeightTable& weights,
+		CandidateScratch& scratch);
+
+	// Upper bound of c's weighted PI from the summed (not unioned) instance counts of the
+	// keys containing c; costs a superset lookup but no bitmap unions
+	template <size_t W>
+	double weightedPIUpperBound(
+		const ColocationMask<W>& c,
+		const SupersetIndex<W>& index,
+		const std::vector<int>& featureCounts,
+		const RareWeightTable& weights,
+		CandidateScratch& scratch);
 
-	// Compute weighted participation index for a colocation
+	// Upper bound of c's weighted PI from the pairwise participation counts alone: O(|c|^2)
+	// table reads, no superset lookup. Infinity without a pairwise table.
+	template <size_t W>
+	double pairwiseUpperBound(
+		const ColocationMask<W>& c,
+		const std::vector<int>& featureCounts,
+		const RareWeightTable& weights,
+		CandidateScratch& scratch);
+
+	// Parallel mode of minePCPs: all candidates of one size at a time
+	template <size_t W>
+	std::set<ColocationMask<W>> mineLevelsParallel(
+		CandidateQueue<W>& candidateColocations,
+		const ParticipationSource<W>& source,
+		const std::vector<int>& featureCounts,
+		const RareWeightTable& weights,
+		double min_prev);
+
+	// Query instances of a colocation from the hashmap keys that contain it; with a parent
+	// (c plus feature removed) only the keys lacking removed are added to the parent's result
+	template <size_t W>
+	FeatureInstances queryInstances(
+		const ColocationMask<W>& c,
+		const SupersetIndex<W>& index,
+		std::vector<uint32_t>& matches,
+		const FeatureInstances* parent = nullptr,
+		size_t removed = 0);
+
+	// Compute weighted participation index from the participation count of each feature of c
+	// (ascending) and the weights of c's min-count feature
+	template <size_t W>
 	double computeWeightedPI(
-		const std::map<FeatureType, std::set<const SpatialInstance*>>& partInstances,
-		Colocation c,
-		const std::unordered_map<FeatureType, double>& rareIntensityMap,
-		const std::map<FeatureType, int>& featureCounts);
+		const std::vector<uint32_t>& participation,
+		const ColocationMask<W>& c,
+		const RareWeightTable& weights,
+		const std::vector<int>& featureCounts);
 
 	// Generate all size-1 subsets of a colocation
-	std::set<Colocation> generateSubsets(const Colocation& c);
+	template <size_t W>
+	std::vector<ColocationMask<W>> generateSubsets(const ColocationMask<W>& c);
 
-	// Deduce prevalent subsets using downward closure property
-	std::set<Colocation> deducePrevalentSubsets(std::set<Colocation>& subsets, const Colocation& c, const std::map<FeatureType, int>& featureCounts);
+	// Feature of c that every subset proven prevalent by the downward closure property keeps
+	template <size_t W>
+	size_t findMinFeature(const ColocationMask<W>& c, const std::vector<int>& featureCounts);
 
 public:
+	// pairwise (if given) must outlive the miner
+	explicit Miner(MiningEngine engine = MiningEngine::Queue, int numThreads = 1, size_t cacheBytes = 0,
+		const PairwiseParticipation* pairwise = nullptr)
+		: engine(engine), numThreads(numThreads), cacheBytes(cacheBytes), pairwise(pairwise) {}
+
 	// Mine prevalent colocation patterns (main algorithm)
-	std::set<Colocation> minePCPs(
-		std::priority_queue<Colocation, std::vector<Colocation>, ColocationPriorityComp>& candidateColocations,
-		const std::map<Colocation, std::map<FeatureType, std::set<const SpatialInstance*>>>& hashMap,
-		const std::map<FeatureType, int>& featureCounts,
-		double delta,
+	template <size_t W>
+	std::set<ColocationMask<W>> minePCPs(
+		CandidateQueue<W>& candidateColocations,
+		const InstanceHashMap<W>& hashMap,
+		const std::vector<int>& featureCounts,
+		const RareWeightTable& weights,
 		double min_prev
 	);
+
+	// Multi-threshold mode: minePCPs' result for each threshold, from a single traversal
+	// that computes each candidate's bound or weighted PI once for all thresholds
+	template <size_t W>
+	std::vector<std::set<ColocationMask<W>>> minePCPsMulti(
+		const CandidateQueue<W>& candidateColocations,
+		const InstanceHashMap<W>& hashMap,
+		const std::vector<int>& featureCounts,
+		const RareWeightTable& weights,
+		const std::vector<double>& thresholds
+	);
+
+	// Top-k mode: the k patterns with the highest weighted PI, best first (ties go to the
+	// larger, then the lexicographically first pattern). No threshold and no Lemma 2
+	// deduction: every candidate's PI is either computed or bounded below the k-th best.
+	template <size_t W>
+	std::vector<std::pair<ColocationMask<W>, double>> mineTopK(
+		CandidateQueue<W>& candidateColocations,
+		const InstanceHashMap<W>& hashMap,
+		const std::vector<int>& featureCounts,
+		const RareWeightTable& weights,
+		size_t k
+	);
 };
\ No newline at end of file
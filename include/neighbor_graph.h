@@ -5,6 +5,8 @@
 
 #pragma once
 #include "types.h"
+#include "instance_store.h"
+#include "distance_kernel.h"
 #include <vector>
 
 /**
@@ -12,17 +14,31 @@
  */
 class NeighborGraph {
 private:
-	// Calculate Euclidean distance between two instances
-	double euclideanDist(const SpatialInstance& a, const SpatialInstance& b);
+	JoinMethod joinMethod;  ///< Engine used by findNeighborPair
+	int numThreads;         ///< Worker threads for the join (slabs or cell runs)
+	DistanceKernelFn distanceKernel;  ///< Candidate filter picked for the running CPU
 
-	// Find all neighbor pairs within distance threshold
-	std::vector<std::pair<SpatialInstance, SpatialInstance>> findNeighborPair(
-		const std::vector<SpatialInstance>& instances,
+	// Find all neighbor pairs (as instance indices) within distance threshold using the configured engine
+	std::vector<std::pair<InstanceIndex, InstanceIndex>> findNeighborPair(
+		const InstanceStore& instances,
+		double distanceThreshold);
+
+	// Plane sweep over X-sorted instances
+	std::vector<std::pair<InstanceIndex, InstanceIndex>> planeSweepJoin(
+		const InstanceStore& instances,
+		double distanceThreshold);
+
+	// Uniform grid join with cell size equal to the distance threshold
+	std::vector<std::pair<InstanceIndex, InstanceIndex>> gridJoin(
+		const InstanceStore& instances,
 		double distanceThreshold);
 
 public:
-	// Build neighbor graph: for each instance, find all neighbors within threshold
-	std::vector<NeighborSet> buildNeighborGraph(
-		const std::vector<SpatialInstance>& instances,
+	// numThreads <= 0 uses every hardware thread
+	explicit NeighborGraph(JoinMethod method = JoinMethod::PlaneSweep, int numThreads = 1);
+
+	// Build CSR neighbor graph over instance indices: for each instance, all neighbors within threshold
+	CSRGraph buildNeighborGraph(
+		const InstanceStore& instances,
 		double distanceThreshold);
 };
\ No newline at end of file
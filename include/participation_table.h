@@ -0,0 +1,36 @@
+/**
+ * @file participation_table.h
+ * @brief Participation counts of every sub-pattern of the hashmap keys, computed up front
+ */
+
+#pragma once
+#include "types.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Superset-zeta transform of the instance hashmap
+ *
+ * The participating instances of feature f in pattern c are the union of K[f] over all
+ * hashmap keys K containing c. The table computes this for every non-empty subset of
+ * every key (size >= 2) in one pass from the largest keys down: each pattern of size k
+ * pushes its per-feature bitmaps into its k subsets of size k - 1. Only patterns that
+ * occur under some key are materialized (sparse), and only two levels of bitmaps are
+ * alive at a time; finished levels are reduced to per-feature counts.
+ */
+template <size_t W>
+class ParticipationTable {
+private:
+	std::unordered_map<ColocationMask<W>, uint32_t, FeatureBitsetHash> offsets;  ///< Pattern -> first count
+	std::vector<uint32_t> counts;   ///< Per-feature participation counts, ascending feature order
+
+public:
+	explicit ParticipationTable(const InstanceHashMap<W>& hashMap);
+
+	// Participation count of each feature of c (ascending feature order); null if no key contains c
+	const uint32_t* find(const ColocationMask<W>& c) const;
+
+	// Number of patterns in the table
+	size_t size() const { return offsets.size(); }
+};
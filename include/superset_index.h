@@ -0,0 +1,43 @@
+/**
+ * @file superset_index.h
+ * @brief Inverted index answering "which hashmap keys contain this pattern"
+ */
+
+#pragma once
+#include "types.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Per-feature posting lists over the keys of an InstanceHashMap
+ *
+ * Key ordinals follow the map's iteration order. The posting list of feature f holds,
+ * ascending, the ordinals of every key containing f (CSR layout: postings[offsets[f] ..
+ * offsets[f + 1])). A query walks the shortest posting list among the pattern's features
+ * and keeps the keys whose mask covers the pattern, so its cost is bounded by the rarest
+ * feature's key count instead of the whole map. The index points into the hashmap, which
+ * must outlive it and stay unmodified.
+ */
+template <size_t W>
+class SupersetIndex {
+private:
+	std::vector<ColocationMask<W>> keys;                 ///< Ordinal -> key mask
+	std::vector<const FeatureInstances*> instances;      ///< Ordinal -> per-feature instances
+	std::vector<uint32_t> offsets;                       ///< Posting list bounds, size numFeatures + 1
+	std::vector<uint32_t> postings;                      ///< Concatenated posting lists
+
+public:
+	// Index every key of hashMap; feature IDs must be below numFeatures
+	SupersetIndex(const InstanceHashMap<W>& hashMap, size_t numFeatures);
+
+	// Ordinals (ascending) of the keys that are supersets of c and, if given, lack feature
+	// excluded; replaces the contents of out
+	void findSupersets(const ColocationMask<W>& c, std::vector<uint32_t>& out, size_t excluded = SIZE_MAX) const;
+
+	// Key mask and per-feature instances of an ordinal
+	const ColocationMask<W>& key(uint32_t ordinal) const { return keys[ordinal]; }
+	const FeatureInstances& entry(uint32_t ordinal) const { return *instances[ordinal]; }
+
+	// Number of indexed keys
+	size_t size() const { return keys.size(); }
+};
@@ -0,0 +1,66 @@
+/**
+ * @file thread_pool.h
+ * @brief Work-stealing thread pool for irregular parallel workloads
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size pool of workers, each with its own task deque
+ *
+ * A worker pops its own newest task first (LIFO, cache friendly) and, when its deque is
+ * empty, steals the oldest task of another worker (FIFO, usually the largest remaining
+ * work). Tasks receive the index of the worker running them so callers can keep
+ * per-worker buffers without locks. Tasks may submit further tasks.
+ */
+class WorkStealingPool {
+public:
+	using Task = std::function<void(size_t workerId)>;
+
+	// numThreads <= 0 uses every hardware thread
+	explicit WorkStealingPool(int numThreads);
+	~WorkStealingPool();
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	// Number of workers
+	size_t size() const { return queues.size(); }
+
+	// Queue a task: onto the caller's own deque from inside a task, otherwise round-robin
+	void submit(Task task);
+
+	// Block until every submitted task (including nested submissions) has finished
+	void wait();
+
+private:
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::vector<std::thread> threads;
+
+	std::atomic<size_t> queued{ 0 };     ///< Tasks waiting in some deque
+	std::atomic<size_t> pending{ 0 };    ///< Tasks submitted but not yet finished
+	std::atomic<size_t> nextQueue{ 0 };  ///< Round-robin cursor for external submissions
+
+	std::mutex idleMutex;
+	std::condition_variable workAvailable;
+	std::condition_variable allDone;
+	bool stopping = false;
+
+	void workerLoop(size_t workerId);
+	bool popOwn(size_t workerId, Task& task);
+	bool steal(size_t thiefId, Task& task);
+};
\ No newline at end of file
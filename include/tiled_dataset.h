@@ -0,0 +1,128 @@
+/**
+ * @file tiled_dataset.h
+ * @brief Bounded-memory ingest: a dataset spilled to on-disk spatial tiles with a neighbor halo
+ */
+
+#pragma once
+#include "types.h"
+#include "instance_store.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Dataset kept on disk as spatial tiles and processed one tile at a time
+ *
+ * ingest() reads the dataset in fixed-size batches and spills every point (coordinates,
+ * feature, rank within the feature) to disk, so only the feature dictionary, the counts
+ * and the bounding box stay in memory. The bounding box is covered by a grid of cells at
+ * least one neighbor distance wide, so every neighbor of a point lies in its own or an
+ * adjacent cell. A tile is a rectangle of cells; its spill file holds its core cells plus
+ * the one-cell ring around them, i.e. the full neighborhood of every core point.
+ *
+ * A maximal clique whose minimum-index vertex is a core point of a tile lies entirely in
+ * that tile's file and is maximal there exactly when it is maximal in the whole graph, so
+ * keeping each clique in the tile that owns its minimum-index vertex yields every maximal
+ * clique exactly once. Tile points are kept in dataset order, so that vertex is simply the
+ * clique's smallest tile index.
+ *
+ * Tiles are sized from the memory budget: a tile whose points would need more than half
+ * of it is split in two along its longer side until it fits or is a single cell.
+ */
+class TiledDataset {
+public:
+	/** @brief One tile loaded for processing */
+	struct Tile {
+		InstanceStore instances;     ///< Core and halo points in dataset order: x, y, final feature IDs and dataset-wide
+		                             ///< feature ranks (no instance numbers; the dictionary is TiledDataset::features)
+		std::vector<uint8_t> core;   ///< core[i] = 1 if instance i lies in the tile's core cells
+	};
+
+	/**
+	 * @brief Called once per tile; returns the bytes its processing needed, which refines
+	 * the per-point estimate that sizes the tiles still to come
+	 */
+	using TileVisitor = std::function<size_t(const Tile& tile)>;
+
+	/** @brief Counters of forEachTile */
+	struct TileStats {
+		size_t tiles = 0;             ///< Tiles processed
+		size_t splits = 0;            ///< Tiles split for exceeding the budget
+		size_t largestTile = 0;       ///< Most points (core and halo) in one processed tile
+		size_t overBudgetTiles = 0;   ///< Single-cell tiles processed although above the budget
+	};
+
+	// Spill files go to a fresh directory under spillDirectory (the system temporary directory if empty)
+	TiledDataset(const std::string& spillDirectory, size_t memoryBudgetBytes, double distanceThreshold);
+
+	// Removes the spill directory
+	~TiledDataset();
+
+	TiledDataset(const TiledDataset&) = delete;
+	TiledDataset& operator=(const TiledDataset&) = delete;
+
+	// Read the dataset (CSV or binary) in batches and spill its points; call once
+	void ingest(const std::string& filepath);
+
+	// Cut the spilled points into tiles and hand them to visit one at a time; call once
+	// (spill files are removed as they are consumed)
+	void forEachTile(const TileVisitor& visit);
+
+	// Number of instances ingested
+	uint64_t size() const { return numInstances; }
+
+	// Feature names (finalized: IDs in ascending name order)
+	const FeatureDictionary& features() const { return dictionary; }
+
+	// Instances per feature ID
+	const std::vector<int>& featureCounts() const { return counts; }
+
+	// Counters of forEachTile
+	const TileStats& getStats() const { return stats; }
+
+private:
+	// Cells [x0, x1) x [y0, y1) of the grid and the spill file of their points (with halo)
+	struct TileRect {
+		uint32_t x0, y0, x1, y1;
+		std::string path;
+		uint64_t points = 0;         ///< Records in the file
+		uint64_t corePoints = 0;     ///< Records inside the rectangle itself
+	};
+
+	std::string directory;           ///< Spill directory owned by this object
+	size_t memoryBudget;             ///< Bytes the batches and one tile may use
+	size_t batchBytes;               ///< Bytes per ingest and spill read
+	double distance;                 ///< Neighbor distance (minimum cell width)
+	double bytesPerPoint;            ///< Estimated processing bytes per tile point (grows with observed tiles)
+
+	FeatureDictionary dictionary;    ///< Finalized feature names
+	std::vector<FeatureID> finalIds; ///< First-seen feature ID (as spilled) -> final ID
+	std::vector<int> counts;         ///< Instances per final feature ID
+	uint64_t numInstances = 0;
+
+	std::string pointsFile;          ///< All spilled points, in dataset order
+	double originX = 0.0, originY = 0.0;
+	double cellSide = 1.0;
+	uint32_t cellsX = 1, cellsY = 1;
+
+	size_t nextFile = 0;             ///< Suffix of the next spill file
+	TileStats stats;
+
+	// Fresh spill file path
+	std::string spillPath();
+
+	// Grid cell of a coordinate (clamped to the grid)
+	uint32_t cellOf(double value, double origin, uint32_t cells) const;
+
+	// Largest tile (core and halo points) that fits the budget at the current estimate
+	uint64_t maxTilePoints() const;
+
+	// Copy the records of source into one file per grid tile (tile (i, j) spans cells
+	// [xBounds[i], xBounds[i + 1]) x [yBounds[j], yBounds[j + 1])), each with its halo
+	std::vector<TileRect> distribute(const std::string& source,
+		const std::vector<uint32_t>& xBounds, const std::vector<uint32_t>& yBounds);
+
+	// Read a tile's spill file
+	Tile loadTile(const TileRect& rect) const;
+};
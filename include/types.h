@@ -7,9 +7,16 @@
  */
 
 #pragma once
+#include "feature_bitset.h"
+#include "instance_bitmap.h"
+#include "column.h"
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <queue>
 
  // ============================================================================
  // Type Aliases
@@ -21,36 +28,72 @@ using FeatureType = std::string;
 /** @brief Type alias for instance identifiers (e.g., "A1", "B2") */
 using InstanceID = std::string;
 
-/** @brief Type alias for a colocation pattern (set of feature types) */
+/** @brief Type alias for the dense 32-bit position of an instance in the loaded dataset */
+using InstanceIndex = uint32_t;
+
+/** @brief Type alias for an interned feature type (see FeatureDictionary) */
+using FeatureID = uint16_t;
+
+/** @brief Largest representable FeatureID */
+constexpr FeatureID kMaxFeatureID = UINT16_MAX;
+
+/** @brief Type alias for a colocation pattern (set of feature types), used for reports */
 using Colocation = std::vector<FeatureType>;
 
-/** @brief Type alias for a colocation instance (set of spatial instance pointers) */
-using ColocationInstance = std::vector<const struct SpatialInstance*>;
+/** @brief Type alias for a colocation pattern as a bitmask over feature IDs (64 * W features) */
+template <size_t W>
+using ColocationMask = FeatureBitset<W>;
+
+/** @brief Type alias for a colocation instance (set of instance indices) */
+using ColocationInstance = std::vector<InstanceIndex>;
+
+/** @brief Type alias for the participating instances of each feature of a pattern (by feature rank) */
+using FeatureInstances = std::map<FeatureID, InstanceBitmap>;
+
+/** @brief Type alias for the instance hashmap: colocation -> feature -> participating instances */
+template <size_t W>
+using InstanceHashMap = std::map<ColocationMask<W>, FeatureInstances>;
 
 // ============================================================================
-// Data Structures
+// Enumerations
 // ============================================================================
 
 /**
- * @brief Structure representing a spatial data instance
- *
- * Each spatial instance has a feature type, unique identifier, and 2D coordinates.
+ * @brief Spatial join engine used to find neighbor pairs
  */
-struct SpatialInstance {
-    FeatureType type;  ///< Feature type of this instance (e.g., "A", "B")
-    InstanceID id;     ///< Unique identifier (e.g., "A1", "B2")
-    double x, y;       ///< 2D spatial coordinates
+enum class JoinMethod {
+    PlaneSweep,  ///< Sort by X and scan forward while the X gap is within the threshold
+    Grid         ///< Bucket instances into square cells and compare the 3x3 cell neighborhood
 };
 
 /**
- * @brief Structure representing a star neighborhood
+ * @brief Source of participating instances during mining
+ */
+enum class MiningEngine {
+    Queue,  ///< Query the hashmap keys containing each candidate as it is popped
+    Zeta    ///< Superset-zeta transform over all key subsets before mining, then table lookups
+};
+
+// ============================================================================
+// Data Structures
+// ============================================================================
+
+/**
+ * @brief Neighbor graph in compressed sparse row (CSR) form
  *
- * A star neighborhood consists of a center instance and all its neighboring instances
- * within the distance threshold.
+ * Nodes are instance indices into the loaded dataset. The neighbors of node v are
+ * neighbors[offsets[v] .. offsets[v + 1]), sorted ascending, and every edge is stored
+ * in both directions.
  */
-struct NeighborSet {
-    const SpatialInstance* center;                      ///< Center instance
-    std::vector<const SpatialInstance*> neighbors;      ///< All neighbors within distance threshold
+struct CSRGraph {
+    Column<uint64_t> offsets;               ///< Row offsets, size numNodes() + 1
+    Column<InstanceIndex> neighbors;        ///< Concatenated sorted adjacency lists
+    std::shared_ptr<const MappedFile> backing;   ///< Mapping the borrowed arrays point into (cached graphs)
+
+    size_t numNodes() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    size_t degree(InstanceIndex v) const { return offsets[v + 1] - offsets[v]; }
+    const InstanceIndex* begin(InstanceIndex v) const { return neighbors.data() + offsets[v]; }
+    const InstanceIndex* end(InstanceIndex v) const { return neighbors.data() + offsets[v + 1]; }
 };
 
 /**
@@ -59,12 +102,19 @@ struct NeighborSet {
  * 1. Prioritize larger Colocation sizes.
  * 2. If sizes are equal, prioritize smaller lexicographical order (A before B).
  */
+template <size_t W>
 struct ColocationPriorityComp {
-    bool operator()(const Colocation& a, const Colocation& b) const {
+    bool operator()(const ColocationMask<W>& a, const ColocationMask<W>& b) const {
         // If sizes are different: The smaller one has lower priority (return true)
-        if (a.size() != b.size()) {
-            return a.size() < b.size();
+        size_t sizeA = a.count();
+        size_t sizeB = b.count();
+        if (sizeA != sizeB) {
+            return sizeA < sizeB;
         }
-        return a > b;
+        return lexicographicLess(b, a);
     }
-};
\ No newline at end of file
+};
+
+/** @brief Type alias for the candidate queue (largest, then lexicographically first, on top) */
+template <size_t W>
+using CandidateQueue = std::priority_queue<ColocationMask<W>, std::vector<ColocationMask<W>>, ColocationPriorityComp<W>>;
\ No newline at end of file
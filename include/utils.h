@@ -6,6 +6,7 @@
 #pragma once
 
 #include "types.h"
+#include "instance_store.h"
 #include <map>
 #include <unordered_map>
 #include <set>
@@ -18,13 +19,85 @@
 // ============================================================================
 
 // Count instances per feature type and sort by frequency
-std::map<FeatureType, int> countAndSortFeatures(const std::vector<SpatialInstance>& instances);
+std::map<FeatureType, int> countAndSortFeatures(const InstanceStore& instances);
+
+// Count instances per feature type from per-ID counts (datasets that are not held in memory)
+std::map<FeatureType, int> countAndSortFeatures(const FeatureDictionary& features, const std::vector<int>& countsById);
+
+// Count instances per feature ID (index = FeatureID)
+std::vector<int> countFeaturesById(const InstanceStore& instances);
 
 // Calculate dispersion (delta) from feature distribution
 double calculateDirpersion(const std::map<FeatureType, int>& featureCount);
 
-// Calculate rare intensity for each instance in a colocation
-std::unordered_map<FeatureType, double> calcRareIntensity(
-	Colocation c,
-	const std::map<FeatureType, int>& featureCounts,
+/**
+ * @brief Rare-intensity weights W_log = 1 / RI for every (f_min, f) pair of feature IDs
+ *
+ * RI of feature f in a pattern depends only on N(f) and N(f_min), the smallest feature
+ * count in the pattern, so one table over the distinct counts serves every candidate.
+ * D distinct counts need at least D(D + 1) / 2 instances, so the table stays within
+ * twice the dataset size however many features there are.
+ */
+struct RareWeightTable {
+	size_t numClasses = 0;
+	std::vector<uint32_t> countClass;   ///< Feature ID -> index of its count among the distinct counts
+	std::vector<double> weights;        ///< Row class of f_min, column class of f
+
+	// Weights, by count class, for patterns whose min-count feature is fMin
+	const double* row(size_t fMin) const { return weights.data() + countClass[fMin] * numClasses; }
+
+	// W_log of feature f in a pattern whose weight row is row
+	double weight(const double* row, size_t f) const { return row[countClass[f]]; }
+};
+
+// Calculate rare intensity weights for every (f_min, f) pair once
+RareWeightTable buildRareWeightTable(
+	const std::vector<int>& featureCounts,
 	double delta);
+
+/** @brief Widest dictionary given a pairwise table (4096^2 counts = 64 MB) */
+constexpr size_t kMaxPairwiseFeatures = 4096;
+
+/**
+ * @brief Pairwise participation counts from the neighbor graph
+ *
+ * count(fi, fj) is the number of fi instances with at least one fj neighbor. An fi
+ * instance can only participate in a pattern holding fj if it has an fj neighbor, so
+ * min over fj of count(fi, fj) bounds fi's participation in any pattern. The table is
+ * dense, so dictionaries wider than kMaxPairwiseFeatures get none (and no bound).
+ */
+struct PairwiseParticipation {
+	size_t numFeatures = 0;         ///< 0 when there is no table
+	std::vector<uint32_t> counts;   ///< Row fi, column fj
+
+	// Side of the table kept for a dictionary of the given size (0 = none)
+	static size_t tableFeatures(size_t features) { return features <= kMaxPairwiseFeatures ? features : 0; }
+
+	// Zeroed table for a dictionary of the given size
+	void reset(size_t features) {
+		numFeatures = tableFeatures(features);
+		counts.assign(numFeatures * numFeatures, 0);
+	}
+
+	bool empty() const { return numFeatures == 0; }
+	uint32_t count(size_t fi, size_t fj) const { return counts[fi * numFeatures + fj]; }
+};
+
+// Count, for every ordered feature pair, the instances of the first with a neighbor of the second
+// (no table above kMaxPairwiseFeatures)
+PairwiseParticipation buildPairwiseParticipation(
+	const CSRGraph& graph,
+	const InstanceStore& instances);
+
+// Add the counts of the instances v with counted[v] != 0 (every instance if counted is null)
+// to table, sized by the caller; a part of the dataset adds its share when the graph holds
+// every neighbor of its counted instances
+void accumulatePairwiseParticipation(
+	const CSRGraph& graph,
+	const InstanceStore& instances,
+	const uint8_t* counted,
+	PairwiseParticipation& table);
+
+// Feature names of a colocation mask, in ascending name order
+template <size_t W>
+Colocation toColocation(const ColocationMask<W>& c, const FeatureDictionary& features);
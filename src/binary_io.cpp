@@ -0,0 +1,40 @@
+/**
+ * @file binary_io.cpp
+ * @brief Implementation: File naming and atomic replacement for the binary caches
+ */
+
+#include "binary_io.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+std::string hex64(uint64_t value) {
+	char buffer[17];
+	std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+	return buffer;
+};
+
+std::string openTemporaryFor(const std::string& target, std::ofstream& out) {
+	std::error_code error;
+	std::filesystem::path targetPath(target);
+	if (targetPath.has_parent_path()) std::filesystem::create_directories(targetPath.parent_path(), error);
+
+	std::string temporary = target + ".tmp" +
+		std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+	out.open(temporary, std::ios::binary | std::ios::trunc);
+	return temporary;
+};
+
+bool commitTemporary(std::ofstream& out, const std::string& temporary, const std::string& target) {
+	bool written = static_cast<bool>(out);
+	out.close();
+
+	std::error_code error;
+	if (written) std::filesystem::rename(temporary, target, error);
+	if (!written || error) {
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+	return true;
+};
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 
 
  /**
@@ -16,6 +17,7 @@
   *
   * Parses key=value pairs from the configuration file. Lines starting with '#'
   * are treated as comments. If the file cannot be opened, returns default configuration.
+  * Throws std::runtime_error if top_k and min_prevalence_list are both set.
   */
 AppConfig ConfigLoader::load(const std::string& configPath) {
     AppConfig config;
@@ -37,13 +39,41 @@ AppConfig ConfigLoader::load(const std::string& configPath) {
             std::string value;
             if (std::getline(is_line, value)) {
                 if (key == "dataset_path") config.datasetPath = value;
+                else if (key == "graph_cache_dir") config.graphCacheDir = value;
+                else if (key == "hashmap_index_dir") config.hashmapIndexDir = value;
+                else if (key == "stream_spill_dir") config.streamSpillDir = value;
                 else if (key == "neighbor_distance") config.neighborDistance = std::stod(value);
                 else if (key == "min_prevalence") config.minPrev = std::stod(value);
+                else if (key == "min_prevalence_list") {
+                    std::istringstream list(value);
+                    std::string item;
+                    config.minPrevList.clear();
+                    while (std::getline(list, item, ',')) {
+                        if (item.find_first_not_of(" \t") != std::string::npos) config.minPrevList.push_back(std::stod(item));
+                    }
+                }
                 else if (key == "min_cond_prob") config.minCondProb = std::stod(value);
+                else if (key == "top_k") config.topK = std::stoi(value);
+                else if (key == "join_method") config.joinMethod = (value == "grid") ? JoinMethod::Grid : JoinMethod::PlaneSweep;
+                else if (key == "bitset_bk_max") config.bitsetMaxVertices = std::stoi(value);
+                else if (key == "mining_engine") config.miningEngine = (value == "zeta") ? MiningEngine::Zeta : MiningEngine::Queue;
+                else if (key == "participation_cache_mb") config.participationCacheMB = std::stoi(value);
+                else if (key == "num_threads") config.numThreads = std::stoi(value);
+                else if (key == "stream_memory_mb") config.streamMemoryMB = std::stoi(value);
                 else if (key == "debug_mode") config.debugMode = (value == "true" || value == "1");
             }
         }
     }
 
+    // Top-k mode ranks by weighted PI and has no thresholds
+    if (config.topK > 0) {
+        if (!config.minPrevList.empty()) {
+            throw std::runtime_error("top_k and min_prevalence_list cannot be combined: top-k mode has no thresholds");
+        }
+        if (config.minPrev != AppConfig().minPrev) {
+            std::cerr << "Warning: min_prevalence is ignored in top-k mode (top_k=" << config.topK << ").\n";
+        }
+    }
+
     return config;
 }
\ No newline at end of file
@@ -4,20 +4,467 @@
  */
 
 #include "data_loader.h"
+#include "mapped_file.h"
+#include "binary_io.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
 using namespace csv;
 
+namespace {
+
+    // Run task(t) for every t in [0, numTasks) on its own thread (the caller runs task 0)
+    template <typename Task>
+    void runOnThreads(size_t numTasks, Task task) {
+        std::vector<std::thread> workers;
+        workers.reserve(numTasks);
+        for (size_t t = 1; t < numTasks; ++t) {
+            workers.emplace_back(task, t);
+        }
+        task(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Positions of the fixed-schema columns in the header
+    struct CsvLayout {
+        size_t numColumns = 0;
+        size_t feature = SIZE_MAX;
+        size_t instance = SIZE_MAX;
+        size_t x = SIZE_MAX;
+        size_t y = SIZE_MAX;
+    };
+
+    // End of the line starting at p (the '\n' or end), and the line's content end without '\r'
+    inline const char* lineEnd(const char* p, const char* end, const char*& contentEnd) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* stop = newline ? newline : end;
+        contentEnd = (stop > p && stop[-1] == '\r') ? stop - 1 : stop;
+        return stop;
+    }
+
+    // Read the header line; false unless it is comma-separated with Feature, Instance and
+    // LocX/X, LocY/Y columns (X and Y win over LocX and LocY, like the general reader)
+    bool parseLayout(const char* begin, const char* end, CsvLayout& layout) {
+        size_t locX = SIZE_MAX, locY = SIZE_MAX;
+        size_t column = 0;
+        for (const char* field = begin;; ++column) {
+            const char* comma = std::find(field, end, ',');
+            std::string_view name(field, static_cast<size_t>(comma - field));
+            if (name == "Feature") layout.feature = column;
+            else if (name == "Instance") layout.instance = column;
+            else if (name == "X") layout.x = column;
+            else if (name == "Y") layout.y = column;
+            else if (name == "LocX") locX = column;
+            else if (name == "LocY") locY = column;
+            if (comma == end) break;
+            field = comma + 1;
+        }
+        if (layout.x == SIZE_MAX) layout.x = locX;
+        if (layout.y == SIZE_MAX) layout.y = locY;
+        layout.numColumns = column + 1;
+        return layout.feature != SIZE_MAX && layout.instance != SIZE_MAX &&
+            layout.x != SIZE_MAX && layout.y != SIZE_MAX;
+    }
+
+    // Exact powers of ten representable as doubles
+    constexpr double kExactPow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    // strtod on a field that is not NUL-terminated; the whole field must be consumed
+    bool parseDoubleSlow(const char* begin, const char* end, double& out) {
+        char buffer[128];
+        size_t length = static_cast<size_t>(end - begin);
+        if (length == 0 || length >= sizeof(buffer)) return false;
+        std::memcpy(buffer, begin, length);
+        buffer[length] = '\0';
+
+        char* stop = nullptr;
+        out = std::strtod(buffer, &stop);
+        return stop == buffer + length;
+    }
+
+    // Decimal field to double. Plain [sign]digits[.digits][e[sign]digits] with at most 19
+    // significant digits whose value and power of ten are both exact doubles is converted
+    // with one correctly rounded multiply or divide (Clinger's fast path); everything else
+    // goes through strtod, so the result always equals strtod's.
+    bool parseDouble(const char* begin, const char* end, double& out) {
+        const char* p = begin;
+        bool negative = false;
+        if (p != end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool anyDigit = false;
+        for (; p != end && *p >= '0' && *p <= '9'; ++p) {
+            anyDigit = true;
+            if (mantissa == 0 && *p == '0') continue;
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            ++digits;
+        }
+        if (p != end && *p == '.') {
+            for (++p; p != end && *p >= '0' && *p <= '9'; ++p) {
+                anyDigit = true;
+                --exponent;
+                if (mantissa == 0 && *p == '0') continue;
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                ++digits;
+            }
+        }
+        if (anyDigit && p != end && (*p == 'e' || *p == 'E')) {
+            const char* q = p + 1;
+            bool negativeExp = false;
+            if (q != end && (*q == '-' || *q == '+')) negativeExp = (*q++ == '-');
+            int value = 0;
+            bool expDigit = false;
+            for (; q != end && *q >= '0' && *q <= '9' && value < 10000; ++q) {
+                value = value * 10 + (*q - '0');
+                expDigit = true;
+            }
+            if (expDigit) {
+                exponent += negativeExp ? -value : value;
+                p = q;
+            }
+        }
+        if (!anyDigit || p != end || digits > 19) return parseDoubleSlow(begin, end, out);
+
+        if (mantissa == 0) {
+            out = negative ? -0.0 : 0.0;
+            return true;
+        }
+        if (mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22) {
+            return parseDoubleSlow(begin, end, out);
+        }
+        double value = static_cast<double>(mantissa);
+        value = (exponent < 0) ? value / kExactPow10[-exponent] : value * kExactPow10[exponent];
+        out = negative ? -value : value;
+        return true;
+    }
+
+    // Decimal integer field ([sign]digits) to int
+    bool parseInt(const char* begin, const char* end, int& out) {
+        const char* p = begin;
+        bool negative = false;
+        if (p != end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+        if (p == end) return false;
+
+        int64_t value = 0;
+        for (; p != end; ++p) {
+            if (*p < '0' || *p > '9') return false;
+            value = value * 10 + (*p - '0');
+            if (value > INT32_MAX + int64_t(1)) return false;
+        }
+        value = negative ? -value : value;
+        if (value > INT32_MAX || value < INT32_MIN) return false;
+        out = static_cast<int>(value);
+        return true;
+    }
+
+    // Rows of one chunk, parsed straight into their slots of the store's columns
+    struct ChunkParser {
+        const CsvLayout& layout;
+        InstanceStore& instances;
+        std::unordered_map<std::string_view, FeatureID> localIds;   ///< Feature name -> chunk-local ID
+        std::vector<std::string_view> localNames;                  ///< Chunk-local ID -> feature name
+
+        // Parse the line [begin, end) into row; false on a malformed row
+        bool parseRow(const char* begin, const char* end, size_t row) {
+            size_t column = 0;
+            bool complete = true;
+            for (const char* field = begin;; ++column) {
+                const char* comma = static_cast<const char*>(std::memchr(field, ',', static_cast<size_t>(end - field)));
+                const char* fieldEnd = comma ? comma : end;
+
+                if (column == layout.feature) {
+                    std::string_view name(field, static_cast<size_t>(fieldEnd - field));
+                    auto it = localIds.find(name);
+                    if (it == localIds.end()) {
+                        it = localIds.emplace(name, static_cast<FeatureID>(localNames.size())).first;
+                        localNames.push_back(name);
+                    }
+                    instances.featureId[row] = it->second;
+                }
+                else if (column == layout.instance) complete &= parseInt(field, fieldEnd, instances.instanceNumber[row]);
+                else if (column == layout.x) complete &= parseDouble(field, fieldEnd, instances.x[row]);
+                else if (column == layout.y) complete &= parseDouble(field, fieldEnd, instances.y[row]);
+
+                if (!comma) break;
+                field = comma + 1;
+            }
+            return complete && column + 1 == layout.numColumns;
+        }
+    };
+
+    // Binary dataset header (first bytes of the file)
+    struct BinaryHeader {
+        char magic[8];                  ///< kBinaryMagic
+        uint32_t version;               ///< kBinaryVersion
+        uint32_t byteOrder;             ///< kByteOrderMark as written by the producing machine
+        uint64_t numInstances;
+        uint64_t numFeatures;
+        uint64_t namesOffset;           ///< numFeatures + 1 name end offsets (uint64), then the name bytes
+        uint64_t xOffset;               ///< double[numInstances]
+        uint64_t yOffset;               ///< double[numInstances]
+        uint64_t featureIdOffset;       ///< FeatureID[numInstances]
+        uint64_t instanceNumberOffset;  ///< int32[numInstances]
+        uint64_t featureRankOffset;     ///< uint32[numInstances]
+        uint64_t fileSize;
+    };
+
+    constexpr char kBinaryMagic[8] = { 'C', 'O', 'L', 'O', 'C', 'B', 'I', 'N' };
+    constexpr uint32_t kBinaryVersion = 1;
+
+    static_assert(sizeof(int) == 4, "binary datasets store instance numbers as 32-bit ints");
+
+    // Throw unless header is a supported binary dataset header for a file of fileSize bytes
+    void checkBinaryHeader(const BinaryHeader& header, uint64_t fileSize, const std::string& filepath) {
+        if (std::memcmp(header.magic, kBinaryMagic, sizeof(kBinaryMagic)) != 0) {
+            throw std::runtime_error("Not a binary dataset (bad magic): " + filepath);
+        }
+        if (header.version != kBinaryVersion || header.byteOrder != kByteOrderMark) {
+            throw std::runtime_error("Unsupported binary dataset (version or byte order): " + filepath);
+        }
+        if (header.fileSize != fileSize || header.numFeatures > size_t(kMaxFeatureID) + 1) {
+            throw std::runtime_error("Corrupt binary dataset (header): " + filepath);
+        }
+    }
+
+    // View count values of type T at offset, or throw if they do not lie inside the file
+    template <typename T>
+    Column<T> borrowColumn(const MappedFile& file, uint64_t offset, uint64_t count, const std::string& filepath) {
+        Column<T> column;
+        if (!borrowArray(file, offset, count, column)) {
+            throw std::runtime_error("Corrupt binary dataset (column out of range): " + filepath);
+        }
+        return column;
+    }
+}
 
 /**
  * @brief Load spatial instances from a CSV file
  * @param filepath Path to the CSV file
- * @return std::vector<SpatialInstance> Vector of loaded spatial instances
+ * @param numThreads Parser threads for the fast path (<= 0 uses every hardware thread)
+ * @return InstanceStore Columnar store of the loaded instances, in file order
  *
  * Expects CSV with columns: Feature, Instance, LocX, LocY.
- * Instance IDs are generated as: FeatureType + InstanceNumber (e.g., "A1", "B2").
+ * Feature names are interned; IDs are renumbered in name order once loading finishes.
  */
-std::vector<SpatialInstance> DataLoader::load_csv(const std::string& filepath) {
+InstanceStore DataLoader::load_csv(const std::string& filepath, int numThreads) {
+    InstanceStore instances;
+    if (loadMapped(filepath, numThreads, instances)) return instances;
+    return loadWithReader(filepath);
+}
+
+// Dispatch on the first bytes: binary datasets carry kBinaryMagic, anything else is CSV
+InstanceStore DataLoader::load(const std::string& filepath, int numThreads) {
+    char magic[sizeof(kBinaryMagic)] = {};
+    {
+        std::ifstream in(filepath, std::ios::binary);
+        in.read(magic, sizeof(magic));
+    }
+    if (std::memcmp(magic, kBinaryMagic, sizeof(magic)) == 0) return load_binary(filepath);
+    return load_csv(filepath, numThreads);
+}
+
+// Map the file and point the columns at it; only the header, the dictionary and the
+// feature columns (which later stages use as indices) are checked
+InstanceStore DataLoader::load_binary(const std::string& filepath) {
+    auto file = std::make_shared<MappedFile>(filepath);
+
+    BinaryHeader header;
+    if (file->size() < sizeof(header)) {
+        throw std::runtime_error("Not a binary dataset (file too short): " + filepath);
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    checkBinaryHeader(header, file->size(), filepath);
+
+    InstanceStore instances;
+
+    // Dictionary: names are stored in ID order, which must be ascending name order
+    const Column<uint64_t> nameEnds = borrowColumn<uint64_t>(*file, header.namesOffset, header.numFeatures + 1, filepath);
+    const char* nameBytes = reinterpret_cast<const char*>(nameEnds.end());
+    size_t nameBytesAvailable = file->size() - static_cast<size_t>(nameBytes - file->data());
+    FeatureType previous;
+    for (uint64_t f = 0; f < header.numFeatures; ++f) {
+        if (nameEnds[f] > nameEnds[f + 1] || nameEnds[f + 1] > nameBytesAvailable) {
+            throw std::runtime_error("Corrupt binary dataset (feature names): " + filepath);
+        }
+        FeatureType name(nameBytes + nameEnds[f], static_cast<size_t>(nameEnds[f + 1] - nameEnds[f]));
+        if (f > 0 && !(previous < name)) {
+            throw std::runtime_error("Corrupt binary dataset (feature names out of order): " + filepath);
+        }
+        instances.features.intern(name);
+        previous = std::move(name);
+    }
+
+    size_t n = static_cast<size_t>(header.numInstances);
+    instances.x = borrowColumn<double>(*file, header.xOffset, n, filepath);
+    instances.y = borrowColumn<double>(*file, header.yOffset, n, filepath);
+    instances.featureId = borrowColumn<FeatureID>(*file, header.featureIdOffset, n, filepath);
+    instances.instanceNumber = borrowColumn<int>(*file, header.instanceNumberOffset, n, filepath);
+    instances.featureRank = borrowColumn<uint32_t>(*file, header.featureRankOffset, n, filepath);
+
+    // Feature IDs and ranks index per-feature arrays downstream: they must be exactly what
+    // finalizeFeatures would assign
+    const InstanceStore& view = instances;
+    std::vector<uint32_t> nextRank(header.numFeatures, 0);
+    for (size_t i = 0; i < n; ++i) {
+        FeatureID f = view.featureId[i];
+        if (f >= header.numFeatures || view.featureRank[i] != nextRank[f]++) {
+            throw std::runtime_error("Corrupt binary dataset (feature column): " + filepath);
+        }
+    }
+
+    instances.backing = std::move(file);
+    return instances;
+}
+
+// Header first (patched once the offsets are known), then the dictionary and the columns
+void DataLoader::save_binary(const InstanceStore& instances, const std::string& filepath) {
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot open file for writing: " + filepath);
+
+    BinaryHeader header = {};
+    std::memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+    header.version = kBinaryVersion;
+    header.byteOrder = kByteOrderMark;
+    header.numInstances = instances.size();
+    header.numFeatures = instances.features.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    header.namesOffset = alignStream(out);
+    std::vector<uint64_t> nameEnds(1, 0);
+    for (size_t f = 0; f < instances.features.size(); ++f) {
+        nameEnds.push_back(nameEnds.back() + instances.features.name(static_cast<FeatureID>(f)).size());
+    }
+    out.write(reinterpret_cast<const char*>(nameEnds.data()), static_cast<std::streamsize>(nameEnds.size() * sizeof(uint64_t)));
+    for (size_t f = 0; f < instances.features.size(); ++f) {
+        const FeatureType& name = instances.features.name(static_cast<FeatureID>(f));
+        out.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+
+    header.xOffset = writeAlignedArray(out, instances.x.data(), instances.x.size());
+    header.yOffset = writeAlignedArray(out, instances.y.data(), instances.y.size());
+    header.featureIdOffset = writeAlignedArray(out, instances.featureId.data(), instances.featureId.size());
+    header.instanceNumberOffset = writeAlignedArray(out, instances.instanceNumber.data(), instances.instanceNumber.size());
+    header.featureRankOffset = writeAlignedArray(out, instances.featureRank.data(), instances.featureRank.size());
+    header.fileSize = static_cast<uint64_t>(out.tellp());
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out) throw std::runtime_error("Failed writing binary dataset: " + filepath);
+}
+
+// Fast path: map the file, count the rows of each line-aligned chunk, size the columns
+// once, then let every chunk parse its rows into its own slice of them
+bool DataLoader::loadMapped(const std::string& filepath, int numThreads, InstanceStore& instances) {
+    MappedFile file;
+    try {
+        file = MappedFile(filepath);
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+    if (file.size() == 0 || std::memchr(begin, '"', file.size()) != nullptr) return false;
+
+    // Header
+    const char* headerEnd = nullptr;
+    const char* bodyBegin = lineEnd(begin, end, headerEnd);
+    CsvLayout layout;
+    if (!parseLayout(begin, headerEnd, layout)) return false;
+    if (bodyBegin != end) ++bodyBegin;
+
+    // Chunks of at least 1 MB, cut just after a newline
+    size_t threads = (numThreads > 0) ? static_cast<size_t>(numThreads)
+        : std::max(1u, std::thread::hardware_concurrency());
+    const size_t minChunkBytes = size_t(1) << 20;
+    size_t bodyBytes = static_cast<size_t>(end - bodyBegin);
+    size_t numChunks = std::max<size_t>(1, std::min(threads, bodyBytes / minChunkBytes));
+
+    std::vector<const char*> bounds(numChunks + 1, end);
+    bounds[0] = bodyBegin;
+    for (size_t c = 1; c < numChunks; ++c) {
+        const char* cut = std::max(bounds[c - 1], bodyBegin + bodyBytes / numChunks * c);
+        const char* newline = static_cast<const char*>(std::memchr(cut, '\n', static_cast<size_t>(end - cut)));
+        bounds[c] = newline ? newline + 1 : end;
+    }
+
+    // Pass 1: non-empty lines per chunk
+    std::vector<size_t> rowOffsets(numChunks + 1, 0);
+    runOnThreads(numChunks, [&](size_t c) {
+        size_t rows = 0;
+        for (const char* line = bounds[c]; line < bounds[c + 1];) {
+            const char* contentEnd = nullptr;
+            const char* stop = lineEnd(line, bounds[c + 1], contentEnd);
+            if (contentEnd != line) ++rows;
+            line = stop + 1;
+        }
+        rowOffsets[c + 1] = rows;
+    });
+    for (size_t c = 0; c < numChunks; ++c) rowOffsets[c + 1] += rowOffsets[c];
+
+    size_t numRows = rowOffsets[numChunks];
+    InstanceStore store;
+    store.x.resize(numRows);
+    store.y.resize(numRows);
+    store.featureId.resize(numRows);
+    store.instanceNumber.resize(numRows);
+
+    // Pass 2: parse rows into their slots with chunk-local feature IDs
+    std::vector<ChunkParser> parsers;
+    parsers.reserve(numChunks);
+    for (size_t c = 0; c < numChunks; ++c) parsers.push_back({ layout, store, {}, {} });
+    std::atomic<bool> malformed{ false };
+    runOnThreads(numChunks, [&](size_t c) {
+        size_t row = rowOffsets[c];
+        for (const char* line = bounds[c]; line < bounds[c + 1];) {
+            const char* contentEnd = nullptr;
+            const char* stop = lineEnd(line, bounds[c + 1], contentEnd);
+            if (contentEnd != line && !parsers[c].parseRow(line, contentEnd, row++)) {
+                malformed.store(true, std::memory_order_relaxed);
+                return;
+            }
+            line = stop + 1;
+        }
+    });
+    if (malformed.load()) return false;
+
+    // Intern the names and turn local IDs into dictionary IDs
+    for (size_t c = 0; c < numChunks; ++c) {
+        std::vector<FeatureID> globalIds;
+        globalIds.reserve(parsers[c].localNames.size());
+        for (std::string_view name : parsers[c].localNames) {
+            globalIds.push_back(store.features.intern(FeatureType(name)));
+        }
+        for (size_t row = rowOffsets[c]; row < rowOffsets[c + 1]; ++row) {
+            store.featureId[row] = globalIds[store.featureId[row]];
+        }
+    }
+
+    store.finalizeFeatures();
+    instances = std::move(store);
+    return true;
+}
+
+// General path through csv::CSVReader (any delimiter, quoting, column order)
+InstanceStore DataLoader::loadWithReader(const std::string& filepath) {
     CSVReader reader(filepath);
     auto colNames = reader.get_col_names();
     std::string xCol = "LocX";
@@ -29,18 +476,200 @@ std::vector<SpatialInstance> DataLoader::load_csv(const std::string& filepath) {
     if (hasColumn("X")) xCol = "X";
     if (hasColumn("Y")) yCol = "Y";
 
-    std::vector<SpatialInstance> instances;
+    InstanceStore instances;
 
     for (auto& row : reader) {
-        SpatialInstance instance;
+        instances.add(
+            row["Feature"].get<FeatureType>(),
+            row["Instance"].get<int>(),
+            row[xCol].get<double>(),
+            row[yCol].get<double>());
+    }
+
+    instances.finalizeFeatures();
+    return instances;
+}
 
-        instance.type = row["Feature"].get<FeatureType>();
-        instance.id = instance.type + std::to_string(row["Instance"].get<int>());
-        instance.x = row[xCol].get<double>();
-        instance.y = row[yCol].get<double>();
+// Dispatch like load: binary datasets by their magic, CSV through the fixed-schema reader when it applies
+void DataLoader::stream(const std::string& filepath, size_t batchBytes, FeatureDictionary& features, const BatchVisitor& visit) {
+    batchBytes = std::max<size_t>(batchBytes, 4096);
+    char magic[sizeof(kBinaryMagic)] = {};
+    {
+        std::ifstream in(filepath, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open file: " + filepath);
+        in.read(magic, sizeof(magic));
+    }
+    if (std::memcmp(magic, kBinaryMagic, sizeof(magic)) == 0) {
+        streamBinary(filepath, batchBytes, features, visit);
+        return;
+    }
+    if (!streamFixedSchema(filepath, batchBytes, features, visit)) {
+        streamWithReader(filepath, batchBytes, features, visit);
+    }
+}
 
-        instances.push_back(instance);
+// Read batchBytes at a time; the complete lines of each read form one batch and an
+// unfinished last line is carried into the next read
+bool DataLoader::streamFixedSchema(const std::string& filepath, size_t batchBytes, FeatureDictionary& features, const BatchVisitor& visit) {
+    std::ifstream in(filepath, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open file: " + filepath);
+
+    std::string header;
+    std::getline(in, header);
+    if (!header.empty() && header.back() == '\r') header.pop_back();
+    CsvLayout layout;
+    if (header.find('"') != std::string::npos || !parseLayout(header.data(), header.data() + header.size(), layout)) {
+        return false;
     }
 
-    return instances;
-}
\ No newline at end of file
+    std::vector<char> buffer;
+    size_t carried = 0;
+    InstanceStore batch;
+    while (true) {
+        buffer.resize(std::max(buffer.size(), carried + batchBytes));
+        in.read(buffer.data() + carried, static_cast<std::streamsize>(batchBytes));
+        const char* begin = buffer.data();
+        const char* end = begin + carried + static_cast<size_t>(in.gcount());
+        bool last = !in;
+
+        // Rows of this batch end at the last newline (at the end of the file for the last read)
+        const char* rowsEnd = end;
+        if (!last) {
+            while (rowsEnd != begin && rowsEnd[-1] != '\n') --rowsEnd;
+        }
+        if (std::memchr(begin, '"', static_cast<size_t>(rowsEnd - begin)) != nullptr) {
+            throw std::runtime_error("Quoted field in " + filepath + " (streamed CSV rows must be plain Feature,Instance,X,Y)");
+        }
+
+        size_t rows = 0;
+        for (const char* line = begin; line < rowsEnd;) {
+            const char* contentEnd = nullptr;
+            const char* stop = lineEnd(line, rowsEnd, contentEnd);
+            if (contentEnd != line) ++rows;
+            line = stop + 1;
+        }
+        batch.x.resize(rows);
+        batch.y.resize(rows);
+        batch.featureId.resize(rows);
+        batch.instanceNumber.resize(rows);
+
+        ChunkParser parser{ layout, batch, {}, {} };
+        size_t row = 0;
+        for (const char* line = begin; line < rowsEnd;) {
+            const char* contentEnd = nullptr;
+            const char* stop = lineEnd(line, rowsEnd, contentEnd);
+            if (contentEnd != line && !parser.parseRow(line, contentEnd, row++)) {
+                throw std::runtime_error("Malformed row in " + filepath + ": " + std::string(line, contentEnd));
+            }
+            line = stop + 1;
+        }
+
+        // Local IDs to dictionary IDs while the names still point into the buffer
+        std::vector<FeatureID> ids;
+        ids.reserve(parser.localNames.size());
+        for (std::string_view name : parser.localNames) {
+            ids.push_back(features.intern(FeatureType(name)));
+        }
+        for (size_t r = 0; r < rows; ++r) {
+            batch.featureId[r] = ids[batch.featureId[r]];
+        }
+        if (rows > 0) visit(batch);
+
+        carried = static_cast<size_t>(end - rowsEnd);
+        std::memmove(buffer.data(), rowsEnd, carried);
+        if (last) break;
+    }
+    return true;
+}
+
+// General reader, flushed every batchBytes / 64 rows
+void DataLoader::streamWithReader(const std::string& filepath, size_t batchBytes, FeatureDictionary& features, const BatchVisitor& visit) {
+    CSVReader reader(filepath);
+    auto colNames = reader.get_col_names();
+    std::string xCol = "LocX";
+    std::string yCol = "LocY";
+    if (std::find(colNames.begin(), colNames.end(), "X") != colNames.end()) xCol = "X";
+    if (std::find(colNames.begin(), colNames.end(), "Y") != colNames.end()) yCol = "Y";
+
+    size_t batchRows = batchBytes / 64;
+    InstanceStore batch;
+    for (auto& row : reader) {
+        batch.x.push_back(row[xCol].get<double>());
+        batch.y.push_back(row[yCol].get<double>());
+        batch.featureId.push_back(features.intern(row["Feature"].get<FeatureType>()));
+        batch.instanceNumber.push_back(row["Instance"].get<int>());
+        if (batch.size() == batchRows) {
+            visit(batch);
+            batch = InstanceStore();
+        }
+    }
+    if (batch.size() > 0) visit(batch);
+}
+
+// Header and dictionary first, then the same rows of every column per batch
+void DataLoader::streamBinary(const std::string& filepath, size_t batchBytes, FeatureDictionary& features, const BatchVisitor& visit) {
+    std::ifstream in(filepath, std::ios::binary);
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(filepath, error);
+    BinaryHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || error) {
+        throw std::runtime_error("Not a binary dataset (file too short): " + filepath);
+    }
+    checkBinaryHeader(header, fileSize, filepath);
+
+    // Sections must lie inside the file
+    auto inFile = [&](uint64_t offset, uint64_t count, size_t size) {
+        return offset <= fileSize && count <= (fileSize - offset) / size;
+    };
+    uint64_t n = header.numInstances;
+    if (!inFile(header.namesOffset, header.numFeatures + 1, sizeof(uint64_t)) ||
+        !inFile(header.xOffset, n, sizeof(double)) || !inFile(header.yOffset, n, sizeof(double)) ||
+        !inFile(header.featureIdOffset, n, sizeof(FeatureID)) || !inFile(header.instanceNumberOffset, n, sizeof(int))) {
+        throw std::runtime_error("Corrupt binary dataset (column out of range): " + filepath);
+    }
+
+    // Dictionary (file ID -> ID in features)
+    std::vector<uint64_t> nameEnds(header.numFeatures + 1);
+    in.seekg(static_cast<std::streamoff>(header.namesOffset));
+    in.read(reinterpret_cast<char*>(nameEnds.data()), static_cast<std::streamsize>(nameEnds.size() * sizeof(uint64_t)));
+    uint64_t namesBegin = header.namesOffset + nameEnds.size() * sizeof(uint64_t);
+    if (!in || nameEnds[0] != 0 || !inFile(namesBegin, nameEnds.back(), 1)) {
+        throw std::runtime_error("Corrupt binary dataset (feature names): " + filepath);
+    }
+    std::string names(static_cast<size_t>(nameEnds.back()), '\0');
+    in.read(&names[0], static_cast<std::streamsize>(names.size()));
+    std::vector<FeatureID> ids;
+    for (uint64_t f = 0; f < header.numFeatures; ++f) {
+        if (nameEnds[f] > nameEnds[f + 1]) {
+            throw std::runtime_error("Corrupt binary dataset (feature names): " + filepath);
+        }
+        ids.push_back(features.intern(names.substr(static_cast<size_t>(nameEnds[f]), static_cast<size_t>(nameEnds[f + 1] - nameEnds[f]))));
+    }
+
+    auto readSlice = [&](uint64_t offset, uint64_t first, size_t count, auto* out) {
+        in.seekg(static_cast<std::streamoff>(offset + first * sizeof(*out)));
+        in.read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(count * sizeof(*out)));
+    };
+    size_t batchRows = std::max<size_t>(1, batchBytes / (2 * sizeof(double) + sizeof(FeatureID) + sizeof(int)));
+    InstanceStore batch;
+    for (uint64_t first = 0; first < n; first += batchRows) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(batchRows, n - first));
+        batch.x.resize(count);
+        batch.y.resize(count);
+        batch.featureId.resize(count);
+        batch.instanceNumber.resize(count);
+        readSlice(header.xOffset, first, count, batch.x.data());
+        readSlice(header.yOffset, first, count, batch.y.data());
+        readSlice(header.featureIdOffset, first, count, batch.featureId.data());
+        readSlice(header.instanceNumberOffset, first, count, batch.instanceNumber.data());
+        if (!in) throw std::runtime_error("Failed reading binary dataset: " + filepath);
+
+        for (size_t r = 0; r < count; ++r) {
+            if (batch.featureId[r] >= header.numFeatures) {
+                throw std::runtime_error("Corrupt binary dataset (feature column): " + filepath);
+            }
+            batch.featureId[r] = ids[batch.featureId[r]];
+        }
+        visit(batch);
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * @file distance_kernel.cpp
+ * @brief Implementation: Scalar and AVX2 candidate filters with runtime dispatch
+ */
+
+#include "distance_kernel.h"
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DISTANCE_KERNEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang need the AVX2 code generation enabled per function; MSVC accepts the intrinsics as-is
+#if defined(DISTANCE_KERNEL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define DISTANCE_KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DISTANCE_KERNEL_TARGET_AVX2
+#endif
+
+// Portable scalar implementation
+size_t filterCandidatesScalar(
+	double qx, double qy, FeatureID qf,
+	const double* xs, const double* ys, const FeatureID* fs, size_t count,
+	double maxSquaredDist, uint32_t* hits) {
+	size_t numHits = 0;
+	for (size_t k = 0; k < count; ++k) {
+		double dx = xs[k] - qx;
+		double dy = ys[k] - qy;
+		// Branch-free append: most candidates in a window are rejected
+		hits[numHits] = static_cast<uint32_t>(k);
+		numHits += (fs[k] != qf) & (dx * dx + dy * dy <= maxSquaredDist);
+	}
+	return numHits;
+};
+
+#if defined(DISTANCE_KERNEL_X86)
+
+namespace {
+
+	// Lane mask (bit per candidate) of 4 candidates at xs/ys/fs that are within distance
+	// and of a different feature than the query
+	DISTANCE_KERNEL_TARGET_AVX2
+	inline int filterBlock4(
+		__m256d vqx, __m256d vqy, __m256i vqf, __m256d vMax,
+		const double* xs, const double* ys, const FeatureID* fs) {
+		__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs), vqx);
+		__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys), vqy);
+		__m256d sq = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+		int near = _mm256_movemask_pd(_mm256_cmp_pd(sq, vMax, _CMP_LE_OQ));
+
+		__m256i f = _mm256_cvtepu16_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(fs)));
+		int same = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(f, vqf)));
+		return near & ~same;
+	}
+}
+
+// AVX2 implementation: two vectors of 4 candidates per iteration, scalar tail
+DISTANCE_KERNEL_TARGET_AVX2
+size_t filterCandidatesAVX2(
+	double qx, double qy, FeatureID qf,
+	const double* xs, const double* ys, const FeatureID* fs, size_t count,
+	double maxSquaredDist, uint32_t* hits) {
+	const __m256d vqx = _mm256_set1_pd(qx);
+	const __m256d vqy = _mm256_set1_pd(qy);
+	const __m256d vMax = _mm256_set1_pd(maxSquaredDist);
+	const __m256i vqf = _mm256_set1_epi64x(qf);
+
+	size_t numHits = 0;
+	size_t k = 0;
+	for (; k + 8 <= count; k += 8) {
+		int mask = filterBlock4(vqx, vqy, vqf, vMax, xs + k, ys + k, fs + k) |
+			(filterBlock4(vqx, vqy, vqf, vMax, xs + k + 4, ys + k + 4, fs + k + 4) << 4);
+		for (uint32_t bit = 0; mask != 0; ++bit, mask >>= 1) {
+			if (mask & 1) hits[numHits++] = static_cast<uint32_t>(k) + bit;
+		}
+	}
+	if (k + 4 <= count) {
+		int mask = filterBlock4(vqx, vqy, vqf, vMax, xs + k, ys + k, fs + k);
+		for (uint32_t bit = 0; mask != 0; ++bit, mask >>= 1) {
+			if (mask & 1) hits[numHits++] = static_cast<uint32_t>(k) + bit;
+		}
+		k += 4;
+	}
+
+	size_t tailHits = filterCandidatesScalar(qx, qy, qf, xs + k, ys + k, fs + k, count - k, maxSquaredDist, hits + numHits);
+	for (size_t t = numHits; t < numHits + tailHits; ++t) {
+		hits[t] += static_cast<uint32_t>(k);
+	}
+	return numHits + tailHits;
+};
+
+// True if the running CPU (and OS) support AVX2
+bool cpuSupportsAVX2() {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx) return false;
+	if ((_xgetbv(0) & 0x6) != 0x6) return false;   // XMM and YMM state saved by the OS
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+};
+
+#else
+
+// Non-x86 builds have no AVX2 kernel; forward to the scalar loop
+size_t filterCandidatesAVX2(
+	double qx, double qy, FeatureID qf,
+	const double* xs, const double* ys, const FeatureID* fs, size_t count,
+	double maxSquaredDist, uint32_t* hits) {
+	return filterCandidatesScalar(qx, qy, qf, xs, ys, fs, count, maxSquaredDist, hits);
+};
+
+bool cpuSupportsAVX2() {
+	return false;
+};
+
+#endif
+
+// Best kernel for the running CPU
+DistanceKernelFn selectDistanceKernel() {
+	static const DistanceKernelFn kernel = cpuSupportsAVX2() ? &filterCandidatesAVX2 : &filterCandidatesScalar;
+	return kernel;
+};
+
+// Largest D with std::sqrt(D) <= distanceThreshold
+double squaredDistanceBound(double distanceThreshold) {
+	if (std::isnan(distanceThreshold) || distanceThreshold < 0.0) return -1.0;
+	if (std::isinf(distanceThreshold)) return std::numeric_limits<double>::infinity();
+
+	const double inf = std::numeric_limits<double>::infinity();
+	double bound = distanceThreshold * distanceThreshold;
+
+	// d * d is within an ulp of the answer; step to the exact edge of sqrt's rounding
+	while (std::sqrt(bound) > distanceThreshold) {
+		bound = std::nextafter(bound, 0.0);
+	}
+	while (true) {
+		double next = std::nextafter(bound, inf);
+		if (std::isinf(next) || std::sqrt(next) > distanceThreshold) break;
+		bound = next;
+	}
+	return bound;
+};
\ No newline at end of file
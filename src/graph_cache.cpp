@@ -0,0 +1,114 @@
+/**
+ * @file graph_cache.cpp
+ * @brief Implementation: Persisted neighbor-graph cache
+ */
+
+#include "graph_cache.h"
+#include "binary_io.h"
+#include "mapped_file.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <system_error>
+
+namespace {
+
+	// Cache file header (first bytes of the file)
+	struct GraphCacheHeader {
+		char magic[8];              ///< kGraphCacheMagic
+		uint32_t version;           ///< kGraphCacheVersion
+		uint32_t byteOrder;         ///< kByteOrderMark as written by the producing machine
+		uint64_t datasetHash;       ///< Key: InstanceStore::contentHash
+		uint64_t numInstances;      ///< Key: instance count (= numNodes)
+		uint64_t distanceBits;      ///< Key: bit pattern of the neighbor distance
+		uint64_t numEdges;          ///< Adjacency entries (both directions)
+		uint64_t offsetsOffset;     ///< uint64[numInstances + 1]
+		uint64_t neighborsOffset;   ///< InstanceIndex[numEdges]
+		uint64_t fileSize;
+	};
+
+	constexpr char kGraphCacheMagic[8] = { 'C', 'O', 'L', 'O', 'C', 'C', 'S', 'R' };
+	constexpr uint32_t kGraphCacheVersion = 1;
+}
+
+GraphCache::GraphCache(const std::string& directory, const InstanceStore& instances, double distanceThreshold)
+	: datasetHash(instances.contentHash()),
+	numInstances(instances.size()) {
+	std::memcpy(&distanceBits, &distanceThreshold, sizeof(distanceBits));
+	path = (std::filesystem::path(directory) /
+		("graph_" + hex64(datasetHash) + "_" + hex64(distanceBits) + ".csr")).string();
+};
+
+// Map the entry, check the key and the CSR structure, then borrow its arrays
+bool GraphCache::load(CSRGraph& graph) const {
+	std::error_code error;
+	if (!std::filesystem::is_regular_file(path, error)) return false;
+
+	std::shared_ptr<MappedFile> file;
+	try {
+		file = std::make_shared<MappedFile>(path);
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+
+	GraphCacheHeader header;
+	if (file->size() < sizeof(header)) return false;
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (std::memcmp(header.magic, kGraphCacheMagic, sizeof(kGraphCacheMagic)) != 0 ||
+		header.version != kGraphCacheVersion || header.byteOrder != kByteOrderMark ||
+		header.fileSize != file->size()) {
+		return false;
+	}
+	if (header.datasetHash != datasetHash || header.numInstances != numInstances ||
+		header.distanceBits != distanceBits) {
+		return false;
+	}
+
+	CSRGraph cached;
+	if (!borrowArray(*file, header.offsetsOffset, header.numInstances + 1, cached.offsets) ||
+		!borrowArray(*file, header.neighborsOffset, header.numEdges, cached.neighbors)) {
+		return false;
+	}
+
+	// Rows must tile the neighbor array and every neighbor must be a node
+	const CSRGraph& view = cached;
+	if (view.offsets[0] != 0 || view.offsets[numInstances] != header.numEdges) return false;
+	for (size_t v = 0; v < numInstances; ++v) {
+		if (view.offsets[v] > view.offsets[v + 1]) return false;
+	}
+	for (size_t e = 0; e < header.numEdges; ++e) {
+		if (view.neighbors[e] >= numInstances) return false;
+	}
+
+	cached.backing = std::move(file);
+	graph = std::move(cached);
+	return true;
+};
+
+// Write to a temporary file next to the entry, then rename it into place, so a reader
+// never maps a half-written entry
+bool GraphCache::store(const CSRGraph& graph) const {
+	std::ofstream out;
+	std::string temporary = openTemporaryFor(path, out);
+	if (!out) return false;
+
+	GraphCacheHeader header = {};
+	std::memcpy(header.magic, kGraphCacheMagic, sizeof(kGraphCacheMagic));
+	header.version = kGraphCacheVersion;
+	header.byteOrder = kByteOrderMark;
+	header.datasetHash = datasetHash;
+	header.numInstances = numInstances;
+	header.distanceBits = distanceBits;
+	header.numEdges = graph.neighbors.size();
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	header.offsetsOffset = writeAlignedArray(out, graph.offsets.data(), graph.offsets.size());
+	header.neighborsOffset = writeAlignedArray(out, graph.neighbors.data(), graph.neighbors.size());
+	header.fileSize = static_cast<uint64_t>(out.tellp());
+
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return commitTemporary(out, temporary, path);
+};
@@ -0,0 +1,241 @@
+/**
+ * @file hashmap_index.cpp
+ * @brief Implementation: Persisted instance hashmap index
+ */
+
+#include "hashmap_index.h"
+#include "binary_io.h"
+#include "mapped_file.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace {
+
+	// Index file header (first bytes of the file)
+	struct HashmapIndexHeader {
+		char magic[8];              ///< kHashmapIndexMagic
+		uint32_t version;           ///< kHashmapIndexVersion
+		uint32_t byteOrder;         ///< kByteOrderMark as written by the producing machine
+		uint64_t datasetHash;       ///< Key: InstanceStore::contentHash
+		uint64_t numInstances;      ///< Key: instance count
+		uint64_t distanceBits;      ///< Key: bit pattern of the neighbor distance
+		uint64_t numFeatures;
+		uint64_t maskWords;         ///< W of the stored keys
+		uint64_t numKeys;
+		uint64_t numEntries;        ///< Feature sets over all keys
+		uint64_t numRanks;
+		uint64_t numWords;
+		uint64_t keysOffset;        ///< uint64[numKeys * maskWords], keys in ascending mask order
+		uint64_t keyEntriesOffset;  ///< uint64[numKeys + 1], entry range of each key
+		uint64_t entriesOffset;     ///< IndexEntry[numEntries], ascending feature within a key
+		uint64_t ranksOffset;       ///< uint32[numRanks], sparse sets
+		uint64_t wordsOffset;       ///< uint64[numWords], dense sets
+		uint64_t pairwiseOffset;    ///< uint32[n * n], n = PairwiseParticipation::tableFeatures(numFeatures)
+		uint64_t fileSize;
+	};
+
+	// One feature's instance set within a key
+	struct IndexEntry {
+		uint32_t feature;
+		uint32_t universe;          ///< Instances of the feature
+		uint64_t begin;             ///< First rank or word of the set
+		uint32_t length;            ///< Ranks or words in the set
+		uint32_t dense;             ///< 1: bitmap words, 0: sorted ranks
+	};
+
+	constexpr char kHashmapIndexMagic[8] = { 'C', 'O', 'L', 'O', 'C', 'I', 'D', 'X' };
+	constexpr uint32_t kHashmapIndexVersion = 1;
+}
+
+HashmapIndex::HashmapIndex(const std::string& directory, const InstanceStore& instances, double distanceThreshold)
+	: datasetHash(instances.contentHash()),
+	numInstances(instances.size()),
+	featureCounts(countFeaturesById(instances)) {
+	std::memcpy(&distanceBits, &distanceThreshold, sizeof(distanceBits));
+	path = (std::filesystem::path(directory) /
+		("hashmap_" + hex64(datasetHash) + "_" + hex64(distanceBits) + ".idx")).string();
+};
+
+// Map the file, check the key and every set against the dataset, then rebuild the map
+template <size_t W>
+bool HashmapIndex::load(InstanceHashMap<W>& hashMap, PairwiseParticipation& pairwise) const {
+	std::error_code error;
+	if (!std::filesystem::is_regular_file(path, error)) return false;
+
+	MappedFile file;
+	try {
+		file = MappedFile(path);
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+
+	HashmapIndexHeader header;
+	if (file.size() < sizeof(header)) return false;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, kHashmapIndexMagic, sizeof(kHashmapIndexMagic)) != 0 ||
+		header.version != kHashmapIndexVersion || header.byteOrder != kByteOrderMark ||
+		header.fileSize != file.size()) {
+		return false;
+	}
+	size_t numFeatures = featureCounts.size();
+	size_t pairwiseFeatures = PairwiseParticipation::tableFeatures(numFeatures);
+	if (header.datasetHash != datasetHash || header.numInstances != numInstances ||
+		header.distanceBits != distanceBits || header.numFeatures != numFeatures || header.maskWords != W ||
+		(numFeatures == 0 && header.numKeys != 0)) {
+		return false;
+	}
+
+	Column<uint64_t> keyWords, keyEntries, words;
+	Column<IndexEntry> entries;
+	Column<uint32_t> ranks, pairCounts;
+	if (header.numKeys > file.size() / (W * sizeof(uint64_t)) ||
+		!borrowArray(file, header.keysOffset, header.numKeys * W, keyWords) ||
+		!borrowArray(file, header.keyEntriesOffset, header.numKeys + 1, keyEntries) ||
+		!borrowArray(file, header.entriesOffset, header.numEntries, entries) ||
+		!borrowArray(file, header.ranksOffset, header.numRanks, ranks) ||
+		!borrowArray(file, header.wordsOffset, header.numWords, words) ||
+		!borrowArray(file, header.pairwiseOffset, uint64_t(pairwiseFeatures) * pairwiseFeatures, pairCounts)) {
+		return false;
+	}
+
+	// Rebuild, checking what later stages rely on: keys ascending and within the features,
+	// one set per feature of its key (ascending), sets sized for their feature, ranks sorted
+	const auto& keyView = keyWords;
+	const auto& rangeView = keyEntries;
+	const auto& entryView = entries;
+	const auto& rankView = ranks;
+	const auto& wordView = words;
+	if (rangeView[0] != 0 || rangeView[header.numKeys] != header.numEntries) return false;
+
+	InstanceHashMap<W> loaded;
+	ColocationMask<W> previous;
+	for (size_t k = 0; k < header.numKeys; ++k) {
+		ColocationMask<W> key;
+		std::memcpy(key.words, keyView.data() + k * W, sizeof(key.words));
+		if ((k > 0 && !(previous < key)) || key.anyAbove(numFeatures - 1) || key.empty()) return false;
+		if (rangeView[k] > rangeView[k + 1] || rangeView[k + 1] > header.numEntries) return false;
+
+		FeatureInstances sets;
+		ColocationMask<W> seen;
+		for (uint64_t e = rangeView[k]; e < rangeView[k + 1]; ++e) {
+			const IndexEntry& entry = entryView[e];
+			if (entry.feature >= numFeatures || !key.test(entry.feature) || seen.test(entry.feature) ||
+				entry.universe != static_cast<uint32_t>(featureCounts[entry.feature])) {
+				return false;
+			}
+			seen.set(entry.feature);
+
+			if (entry.dense) {
+				if (entry.length != (uint64_t(entry.universe) + 63) / 64 ||
+					entry.begin > header.numWords || entry.length > header.numWords - entry.begin) {
+					return false;
+				}
+				sets.emplace_hint(sets.end(), static_cast<FeatureID>(entry.feature),
+					InstanceBitmap::fromBitmapWords(entry.universe, wordView.data() + entry.begin, entry.length));
+			}
+			else {
+				if (entry.begin > header.numRanks || entry.length > header.numRanks - entry.begin) return false;
+				const uint32_t* begin = rankView.data() + entry.begin;
+				for (uint32_t r = 0; r < entry.length; ++r) {
+					if (begin[r] >= entry.universe || (r > 0 && begin[r] <= begin[r - 1])) return false;
+				}
+				sets.emplace_hint(sets.end(), static_cast<FeatureID>(entry.feature),
+					InstanceBitmap::fromSortedRanks(entry.universe, begin, entry.length));
+			}
+		}
+		if (seen != key) return false;
+
+		loaded.emplace_hint(loaded.end(), key, std::move(sets));
+		previous = key;
+	}
+
+	const auto& pairView = pairCounts;
+	pairwise.numFeatures = pairwiseFeatures;
+	pairwise.counts.assign(pairView.begin(), pairView.end());
+	hashMap = std::move(loaded);
+	return true;
+};
+
+// Flatten the map (keys in map order), write to a temporary file and rename it into place
+template <size_t W>
+bool HashmapIndex::store(const InstanceHashMap<W>& hashMap, const PairwiseParticipation& pairwise) const {
+	std::vector<uint64_t> keyWords;
+	std::vector<uint64_t> keyEntries(1, 0);
+	std::vector<IndexEntry> entries;
+	std::vector<uint32_t> ranks;
+	std::vector<uint64_t> words;
+	keyWords.reserve(hashMap.size() * W);
+	keyEntries.reserve(hashMap.size() + 1);
+	for (const auto& item : hashMap) {
+		keyWords.insert(keyWords.end(), item.first.words, item.first.words + W);
+		for (const auto& set : item.second) {
+			const InstanceBitmap& bitmap = set.second;
+			IndexEntry entry = {};
+			entry.feature = set.first;
+			entry.universe = bitmap.universeSize();
+			entry.dense = bitmap.isDense() ? 1 : 0;
+			if (bitmap.isDense()) {
+				entry.begin = words.size();
+				entry.length = static_cast<uint32_t>(bitmap.bitmapWords().size());
+				words.insert(words.end(), bitmap.bitmapWords().begin(), bitmap.bitmapWords().end());
+			}
+			else {
+				entry.begin = ranks.size();
+				entry.length = static_cast<uint32_t>(bitmap.sortedRanks().size());
+				ranks.insert(ranks.end(), bitmap.sortedRanks().begin(), bitmap.sortedRanks().end());
+			}
+			entries.push_back(entry);
+		}
+		keyEntries.push_back(entries.size());
+	}
+
+	std::ofstream out;
+	std::string temporary = openTemporaryFor(path, out);
+	if (!out) return false;
+
+	HashmapIndexHeader header = {};
+	std::memcpy(header.magic, kHashmapIndexMagic, sizeof(kHashmapIndexMagic));
+	header.version = kHashmapIndexVersion;
+	header.byteOrder = kByteOrderMark;
+	header.datasetHash = datasetHash;
+	header.numInstances = numInstances;
+	header.distanceBits = distanceBits;
+	header.numFeatures = featureCounts.size();
+	header.maskWords = W;
+	header.numKeys = hashMap.size();
+	header.numEntries = entries.size();
+	header.numRanks = ranks.size();
+	header.numWords = words.size();
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	header.keysOffset = writeAlignedArray(out, keyWords.data(), keyWords.size());
+	header.keyEntriesOffset = writeAlignedArray(out, keyEntries.data(), keyEntries.size());
+	header.entriesOffset = writeAlignedArray(out, entries.data(), entries.size());
+	header.ranksOffset = writeAlignedArray(out, ranks.data(), ranks.size());
+	header.wordsOffset = writeAlignedArray(out, words.data(), words.size());
+	header.pairwiseOffset = writeAlignedArray(out, pairwise.counts.data(), pairwise.counts.size());
+	header.fileSize = static_cast<uint64_t>(out.tellp());
+
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return commitTemporary(out, temporary, path);
+};
+
+// Key widths used by main: 1, 2 and 4 words, then 16, 64, 256 and 1024 (see kMaxMaskWords)
+template bool HashmapIndex::load<1>(InstanceHashMap<1>&, PairwiseParticipation&) const;
+template bool HashmapIndex::load<2>(InstanceHashMap<2>&, PairwiseParticipation&) const;
+template bool HashmapIndex::load<4>(InstanceHashMap<4>&, PairwiseParticipation&) const;
+template bool HashmapIndex::load<16>(InstanceHashMap<16>&, PairwiseParticipation&) const;
+template bool HashmapIndex::load<64>(InstanceHashMap<64>&, PairwiseParticipation&) const;
+template bool HashmapIndex::load<256>(InstanceHashMap<256>&, PairwiseParticipation&) const;
+template bool HashmapIndex::load<1024>(InstanceHashMap<1024>&, PairwiseParticipation&) const;
+template bool HashmapIndex::store<1>(const InstanceHashMap<1>&, const PairwiseParticipation&) const;
+template bool HashmapIndex::store<2>(const InstanceHashMap<2>&, const PairwiseParticipation&) const;
+template bool HashmapIndex::store<4>(const InstanceHashMap<4>&, const PairwiseParticipation&) const;
+template bool HashmapIndex::store<16>(const InstanceHashMap<16>&, const PairwiseParticipation&) const;
+template bool HashmapIndex::store<64>(const InstanceHashMap<64>&, const PairwiseParticipation&) const;
+template bool HashmapIndex::store<256>(const InstanceHashMap<256>&, const PairwiseParticipation&) const;
+template bool HashmapIndex::store<1024>(const InstanceHashMap<1024>&, const PairwiseParticipation&) const;
@@ -0,0 +1,96 @@
+/**
+ * @file instance_bitmap.cpp
+ * @brief Implementation: Hybrid sparse/dense participating-instance sets
+ */
+
+#include "instance_bitmap.h"
+#include "bit_utils.h"
+#include <algorithm>
+#include <iterator>
+
+// Switch to the bitmap representation
+void InstanceBitmap::toDense() {
+	words.assign((static_cast<size_t>(universe) + 63) / 64, 0);
+	for (uint32_t rank : ranks) {
+		words[rank >> 6] |= uint64_t(1) << (rank & 63);
+	}
+	std::vector<uint32_t>().swap(ranks);
+	dense = true;
+};
+
+// Switch if the sorted array is no smaller than the bitmap (4 bytes per rank vs universe / 8)
+void InstanceBitmap::chooseRepresentation() {
+	if (!dense && ranks.size() * 32 >= universe) toDense();
+};
+
+// Add one rank (buffered while sparse)
+void InstanceBitmap::add(uint32_t rank) {
+	if (dense) {
+		words[rank >> 6] |= uint64_t(1) << (rank & 63);
+		return;
+	}
+	ranks.push_back(rank);
+	if (ranks.size() >= compactAt) {
+		compact();
+		compactAt = 2 * ranks.size() + 16;
+	}
+};
+
+// Sort and deduplicate buffered ranks, switching to dense if smaller
+void InstanceBitmap::compact() {
+	if (dense) return;
+	std::sort(ranks.begin(), ranks.end());
+	ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+	chooseRepresentation();
+};
+
+// this |= other (both compacted, same universe)
+void InstanceBitmap::unionWith(const InstanceBitmap& other) {
+	if (universe < other.universe) universe = other.universe;
+
+	if (other.dense) {
+		if (!dense) toDense();
+		for (size_t i = 0; i < other.words.size(); ++i) words[i] |= other.words[i];
+		return;
+	}
+	if (dense) {
+		for (uint32_t rank : other.ranks) words[rank >> 6] |= uint64_t(1) << (rank & 63);
+		return;
+	}
+	if (other.ranks.empty()) return;
+	if (ranks.empty()) {
+		ranks = other.ranks;
+		chooseRepresentation();
+		return;
+	}
+
+	std::vector<uint32_t> merged;
+	merged.reserve(ranks.size() + other.ranks.size());
+	std::set_union(ranks.begin(), ranks.end(), other.ranks.begin(), other.ranks.end(), std::back_inserter(merged));
+	ranks.swap(merged);
+	chooseRepresentation();
+};
+
+// Number of instances in the set
+size_t InstanceBitmap::count() const {
+	if (!dense) return ranks.size();
+	size_t total = 0;
+	for (uint64_t word : words) total += static_cast<size_t>(popcount64(word));
+	return total;
+};
+
+// Rebuild a compacted sparse set (the representation it was saved in is kept)
+InstanceBitmap InstanceBitmap::fromSortedRanks(uint32_t universe, const uint32_t* ranks, size_t count) {
+	InstanceBitmap set(universe);
+	set.ranks.assign(ranks, ranks + count);
+	set.compactAt = 2 * count + 16;
+	return set;
+};
+
+// Rebuild a dense set
+InstanceBitmap InstanceBitmap::fromBitmapWords(uint32_t universe, const uint64_t* words, size_t count) {
+	InstanceBitmap set(universe);
+	set.words.assign(words, words + count);
+	set.dense = true;
+	return set;
+};
@@ -0,0 +1,98 @@
+/**
+ * @file instance_store.cpp
+ * @brief Implementation: Feature interning and columnar instance storage
+ */
+
+#include "instance_store.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+// Return the ID of a feature name, adding it if unseen
+FeatureID FeatureDictionary::intern(const FeatureType& name) {
+	auto it = ids.find(name);
+	if (it != ids.end()) return it->second;
+
+	if (names.size() > kMaxFeatureID) {
+		throw std::runtime_error("Too many distinct features (limit " + std::to_string(kMaxFeatureID + 1) + ")");
+	}
+
+	FeatureID id = static_cast<FeatureID>(names.size());
+	names.push_back(name);
+	ids.emplace(name, id);
+	return id;
+};
+
+// Renumber IDs in ascending name order; returns the old -> new ID mapping
+std::vector<FeatureID> FeatureDictionary::finalize() {
+	std::vector<FeatureID> order(names.size());
+	std::iota(order.begin(), order.end(), FeatureID(0));
+	std::sort(order.begin(), order.end(),
+		[&](FeatureID a, FeatureID b) { return names[a] < names[b]; });
+
+	std::vector<FeatureID> remap(names.size());
+	std::vector<FeatureType> sortedNames;
+	sortedNames.reserve(names.size());
+	for (size_t newId = 0; newId < order.size(); ++newId) {
+		remap[order[newId]] = static_cast<FeatureID>(newId);
+		sortedNames.push_back(std::move(names[order[newId]]));
+	}
+
+	names = std::move(sortedNames);
+	ids.clear();
+	for (size_t id = 0; id < names.size(); ++id) {
+		ids.emplace(names[id], static_cast<FeatureID>(id));
+	}
+	return remap;
+};
+
+// Append one instance (feature name is interned)
+void InstanceStore::add(const FeatureType& feature, int number, double px, double py) {
+	x.push_back(px);
+	y.push_back(py);
+	featureId.push_back(features.intern(feature));
+	instanceNumber.push_back(number);
+};
+
+// Renumber feature IDs in ascending name order and assign featureRank (call once after loading)
+void InstanceStore::finalizeFeatures() {
+	auto remap = features.finalize();
+	for (auto& f : featureId) {
+		f = remap[f];
+	}
+
+	std::vector<uint32_t> nextRank(features.size(), 0);
+	featureRank.resize(featureId.size());
+	for (size_t i = 0; i < featureId.size(); ++i) {
+		featureRank[i] = nextRank[featureId[i]]++;
+	}
+};
+
+// 64-bit hash of the columns that determine the neighbor graph (coordinates and feature IDs)
+uint64_t InstanceStore::contentHash() const {
+	// Finalizer of MurmurHash3: every input bit affects every output bit
+	auto mix = [](uint64_t v) {
+		v ^= v >> 33;
+		v *= 0xff51afd7ed558ccdull;
+		v ^= v >> 33;
+		v *= 0xc4ceb9fe1a85ec53ull;
+		v ^= v >> 33;
+		return v;
+	};
+
+	uint64_t h = mix(size() + 0x9E3779B97F4A7C15ull);
+	for (size_t i = 0; i < size(); ++i) {
+		uint64_t xBits, yBits;
+		std::memcpy(&xBits, &x[i], sizeof(xBits));
+		std::memcpy(&yBits, &y[i], sizeof(yBits));
+		h = mix(h ^ xBits) + yBits;
+		h = mix(h ^ (static_cast<uint64_t>(featureId[i]) << 32 | i));
+	}
+	return h;
+};
+
+// Materialize the instance name (FeatureType + InstanceNumber, e.g., "A1")
+InstanceID InstanceStore::instanceName(InstanceIndex i) const {
+	return featureName(i) + std::to_string(instanceNumber[i]);
+};
\ No newline at end of file
@@ -6,60 +6,249 @@
 #include "config.h"
 #include "data_loader.h"
 #include "neighbor_graph.h"
+#include "graph_cache.h"
+#include "hashmap_index.h"
+#include "tiled_dataset.h"
 #include "maximal_clique_hashmap.h"
 #include "miner.h"
 #include "types.h"
 #include "utils.h"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <iomanip>
 #include <cmath>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
 
-int main(int argc, char* argv[]) {
-    auto programStart = std::chrono::high_resolution_clock::now();
+// One reported pattern; weightedPI is only known in top-k mode (negative otherwise)
+struct PatternReport {
+    Colocation features;
+    double weightedPI;
+};
 
+// Patterns reported for one threshold (title is empty unless several are reported)
+struct PatternSection {
+    std::string title;
+    std::vector<PatternReport> patterns;
+};
 
-    // --- Step 1: Config & Load Data ---
-    std::cout << "[1/3] Loading Configuration and Data...\n";
-    std::string config_path = (argc > 1) ? argv[1] : "./config/config.txt";
-    AppConfig config = ConfigLoader::load(config_path);
+// Patterns of a mask set, sorted by names
+template <size_t W>
+std::vector<PatternReport> sortedReports(const std::set<ColocationMask<W>>& masks, const FeatureDictionary& features) {
+    std::set<Colocation> colocations;
+    for (const auto& mask : masks) {
+        colocations.insert(toColocation(mask, features));
+    }
+    std::vector<PatternReport> reports;
+    for (const auto& colocation : colocations) {
+        reports.push_back({ colocation, -1.0 });
+    }
+    return reports;
+}
 
-    auto instances = DataLoader::load_csv(config.datasetPath);
-    std::cout << "      Dataset: " << config.datasetPath << " | Size: " << instances.size() << " instances\n";
+// Step 2.3: the neighbor graph, mapped from the graph cache when one is configured
+CSRGraph buildGraph(const AppConfig& config, const InstanceStore& instances) {
+    NeighborGraph neighborGraph(config.joinMethod, config.numThreads);
+    if (config.graphCacheDir.empty()) {
+        return neighborGraph.buildNeighborGraph(instances, config.neighborDistance);
+    }
 
+    CSRGraph graph;
+    GraphCache graphCache(config.graphCacheDir, instances, config.neighborDistance);
+    if (graphCache.load(graph)) {
+        std::cout << "      Neighbor graph: cache hit (" << graphCache.filePath() << ")\n";
+    }
+    else {
+        graph = neighborGraph.buildNeighborGraph(instances, config.neighborDistance);
+        bool stored = graphCache.store(graph);
+        std::cout << "      Neighbor graph: " << (stored ? "cached to " : "could not cache to ") << graphCache.filePath() << "\n";
+    }
+    return graph;
+}
 
-    // --- Step 2: Pre-processing (Indexing & Structures) ---
-	std::cout << "[2/3] Building Graph Structures and Hashmap...\n";
+// Step 2.3 - 2.4 for a streamed dataset: join and cliques one tile at a time, keeping the
+// cliques whose minimum-index vertex is a core point and counting pairs for core points only
+template <size_t W>
+void buildFromTiles(
+    const AppConfig& config,
+    TiledDataset& tiles,
+    MaximalCliqueHashmap& mcHashmap,
+    InstanceHashMap<W>& hashMap,
+    PairwiseParticipation& pairwise) {
 
-    // 1. Feature Counting & Sorting
-    auto featureCount = countAndSortFeatures(instances);
+    NeighborGraph neighborGraph(config.joinMethod, config.numThreads);
+    pairwise.reset(tiles.features().size());
 
-	// 2. Delta Calculation
-	double delta = calculateDirpersion(featureCount);
+    tiles.forEachTile([&](const TiledDataset::Tile& tile) {
+        CSRGraph graph = neighborGraph.buildNeighborGraph(tile.instances, config.neighborDistance);
+        mcHashmap.addInstanceHash<W>(graph, tile.instances, tiles.featureCounts(),
+            [&](const InstanceIndex* clique, size_t size) { return tile.core[*std::min_element(clique, clique + size)] != 0; },
+            hashMap);
+        accumulatePairwiseParticipation(graph, tile.instances, tile.core.data(), pairwise);
 
-	// 3. Neighbor Graph Building
-    NeighborGraph neighborGraph;
-    auto graph = neighborGraph.buildNeighborGraph(instances, config.neighborDistance);
+        // Columns, CSR offsets and the clique stage's per-vertex arrays (about 80 bytes per
+        // point), the adjacency and the join's pair buffers (about 12 bytes per entry)
+        return tile.instances.size() * 80 + graph.neighbors.size() * 12;
+    });
 
-	// 4. Build Instance Hashmap from Maximal Cliques
-	MaximalCliqueHashmap mcHashmap;
-    auto hashMap = mcHashmap.buildInstanceHash(graph);
+    const TiledDataset::TileStats& stats = tiles.getStats();
+    std::cout << "      Tiles: " << stats.tiles << " processed, " << stats.splits << " splits, largest "
+        << stats.largestTile << " points (core and halo)\n";
+    if (stats.overBudgetTiles > 0) {
+        std::cout << "      Warning: " << stats.overBudgetTiles << " single-cell tiles exceeded the memory budget\n";
+    }
+}
+
+// Steps 2.3 - 3 with W-word colocation keys; returns the patterns in report order
+// (sorted by names, or ranked in top-k mode), one section per threshold
+// The instances are either in memory or, in streaming mode, spilled to tiles
+template <size_t W>
+std::vector<PatternSection> minePatterns(
+    const AppConfig& config,
+    const InstanceStore& instances,
+    TiledDataset* tiles,
+    const std::vector<int>& featureCounts,
+    const RareWeightTable& weights) {
+
+    const FeatureDictionary& features = tiles ? tiles->features() : instances.features;
+
+	// 3-4. Neighbor graph and Instance Hashmap from Maximal Cliques (or both from the index)
+	MaximalCliqueHashmap mcHashmap(config.numThreads, config.bitsetMaxVertices);
+    InstanceHashMap<W> hashMap;
+    PairwiseParticipation pairwise;
+    auto buildFromGraph = [&]() {
+        CSRGraph graph = buildGraph(config, instances);
+        hashMap = mcHashmap.buildInstanceHash<W>(graph, instances);
+
+        if (config.debugMode) {
+            const BKStats& bk = mcHashmap.getStats();
+            std::cout << "      [debug] BK components: " << bk.components
+                << " | subproblems: " << bk.subproblems
+                << " | cliques: " << bk.cliques
+                << " | bitset subproblems: " << bk.bitsetSubproblems
+                << " | scratch allocations: " << bk.scratchAllocations << "\n";
+        }
+        pairwise = buildPairwiseParticipation(graph, instances);
+    };
+
+    if (tiles) {
+        if (!config.graphCacheDir.empty() || !config.hashmapIndexDir.empty()) {
+            std::cout << "      Streaming ingest: graph cache and hashmap index are not used\n";
+        }
+        buildFromTiles<W>(config, *tiles, mcHashmap, hashMap, pairwise);
+    }
+    else if (config.hashmapIndexDir.empty()) {
+        buildFromGraph();
+    }
+    else {
+        HashmapIndex index(config.hashmapIndexDir, instances, config.neighborDistance);
+        if (index.load<W>(hashMap, pairwise)) {
+            std::cout << "      Instance hashmap: index hit (" << index.filePath() << ")\n";
+        }
+        else {
+            buildFromGraph();
+            bool stored = index.store<W>(hashMap, pairwise);
+            std::cout << "      Instance hashmap: " << (stored ? "indexed to " : "could not index to ") << index.filePath() << "\n";
+        }
+    }
 
 	// 5. Get Candidate Colocations
 	auto candidateQueue = mcHashmap.extractInitialCandidates(hashMap);
 
+    size_t cacheBytes = static_cast<size_t>(std::max(config.participationCacheMB, 0)) << 20;
+    // The tiles are all consumed by now; the cache gets the stream budget in their place
+    if (tiles) cacheBytes = std::min(cacheBytes, size_t(config.streamMemoryMB) << 20);
+    Miner miner(config.miningEngine, config.numThreads, cacheBytes, pairwise.empty() ? nullptr : &pairwise);
+    std::vector<PatternSection> sections;
+
     // --- Step 3: Mining Prevalent Co-location Patterns ---
+    if (config.topK > 0) {
+        std::cout << "[3/3] Mining Patterns (Top-k: " << config.topK << ", Dist: " << config.neighborDistance << ")...\n";
+
+        auto ranked = miner.mineTopK(candidateQueue, hashMap, featureCounts, weights, static_cast<size_t>(config.topK));
+        sections.push_back({ "", {} });
+        for (const auto& entry : ranked) {
+            sections.back().patterns.push_back({ toColocation(entry.first, features), entry.second });
+        }
+        return sections;
+    }
+
+    if (!config.minPrevList.empty()) {
+        std::cout << "[3/3] Mining Patterns (MinPrev: " << config.minPrevList.size() << " thresholds, Dist: " << config.neighborDistance << ")...\n";
+
+        auto perThreshold = miner.minePCPsMulti(candidateQueue, hashMap, featureCounts, weights, config.minPrevList);
+        for (size_t t = 0; t < perThreshold.size(); ++t) {
+            std::ostringstream title;
+            title << "min_prevalence=" << config.minPrevList[t];
+            sections.push_back({ title.str(), sortedReports(perThreshold[t], features) });
+        }
+        return sections;
+    }
+
     std::cout << "[3/3] Mining Patterns (MinPrev: " << config.minPrev << ", Dist: " << config.neighborDistance << ")...\n";
 
-    Miner miner;
-    auto colocations = miner.minePCPs(
+    auto masks = miner.minePCPs(
         candidateQueue,
         hashMap,
-        featureCount,
-        delta,
+        featureCounts,
+        weights,
         config.minPrev
     );
 
+    sections.push_back({ "", sortedReports(masks, features) });
+    return sections;
+}
+
+int main(int argc, char* argv[]) {
+    auto programStart = std::chrono::high_resolution_clock::now();
+
+
+    // --- Step 1: Config & Load Data ---
+    std::cout << "[1/3] Loading Configuration and Data...\n";
+    std::string config_path = (argc > 1) ? argv[1] : "./config/config.txt";
+    AppConfig config = ConfigLoader::load(config_path);
+
+    InstanceStore instances;
+    std::unique_ptr<TiledDataset> tiles;
+    if (config.streamMemoryMB > 0) {
+        tiles = std::make_unique<TiledDataset>(config.streamSpillDir, size_t(config.streamMemoryMB) << 20, config.neighborDistance);
+        tiles->ingest(config.datasetPath);
+        std::cout << "      Dataset: " << config.datasetPath << " | Size: " << tiles->size()
+            << " instances (streamed, budget " << config.streamMemoryMB << " MB)\n";
+    }
+    else {
+        instances = DataLoader::load(config.datasetPath, config.numThreads);
+        std::cout << "      Dataset: " << config.datasetPath << " | Size: " << instances.size() << " instances\n";
+    }
+    const FeatureDictionary& features = tiles ? tiles->features() : instances.features;
+
+
+    // --- Step 2: Pre-processing (Indexing & Structures) ---
+	std::cout << "[2/3] Building Graph Structures and Hashmap...\n";
+
+    // 1. Feature Counting & Sorting
+    auto featureCountsById = tiles ? tiles->featureCounts() : countFeaturesById(instances);
+    auto featureCount = countAndSortFeatures(features, featureCountsById);
+
+	// 2. Delta Calculation
+	double delta = calculateDirpersion(featureCount);
+
+	// 3-5. Graph, hashmap, candidates and mining with the narrowest colocation key that fits
+    auto weights = buildRareWeightTable(featureCountsById, delta);
+    size_t numFeatures = features.size();
+    std::vector<PatternSection> sections;
+    static_assert(64 * kMaxMaskWords > kMaxFeatureID, "the widest mask must hold every FeatureID");
+    if (numFeatures <= 64) sections = minePatterns<1>(config, instances, tiles.get(), featureCountsById, weights);
+    else if (numFeatures <= 128) sections = minePatterns<2>(config, instances, tiles.get(), featureCountsById, weights);
+    else if (numFeatures <= 256) sections = minePatterns<4>(config, instances, tiles.get(), featureCountsById, weights);
+    else if (numFeatures <= 1024) sections = minePatterns<16>(config, instances, tiles.get(), featureCountsById, weights);
+    else if (numFeatures <= 4096) sections = minePatterns<64>(config, instances, tiles.get(), featureCountsById, weights);
+    else if (numFeatures <= 16384) sections = minePatterns<256>(config, instances, tiles.get(), featureCountsById, weights);
+    else sections = minePatterns<kMaxMaskWords>(config, instances, tiles.get(), featureCountsById, weights);
+
     // --- Final Report ---
     auto programEnd = std::chrono::high_resolution_clock::now();
     double totalTime = std::chrono::duration<double>(programEnd - programStart).count();
@@ -67,22 +256,35 @@ int main(int argc, char* argv[]) {
     std::cout << "\n" << std::string(40, '=') << "\n";
     std::cout << "SUMMARY REPORT\n";
     std::cout << "Time:   " << std::fixed << std::setprecision(3) << totalTime << " s\n";
-    std::cout << "Found:  " << colocations.size() << " patterns\n";
+    for (const auto& section : sections) {
+        std::cout << "Found:  " << section.patterns.size() << " patterns";
+        if (!section.title.empty()) std::cout << " (" << section.title << ")";
+        std::cout << "\n";
+    }
     std::cout << std::string(40, '=') << "\n";
 
-    if (!colocations.empty()) {
+    for (const auto& section : sections) {
+        const std::vector<PatternReport>& colocations = section.patterns;
+        if (!section.title.empty()) std::cout << "\n--- " << section.title << " ---\n";
+
+        if (colocations.empty()) {
+            std::cout << "No patterns found.\n";
+            continue;
+        }
         int idx = 1;
-        for (const auto& col : colocations) {
+        for (const auto& report : colocations) {
+            const Colocation& col = report.features;
             std::cout << "[" << idx++ << "] {";
             for (size_t i = 0; i < col.size(); ++i) {
                 std::cout << (i > 0 ? ", " : "") << col[i];
             }
-            std::cout << "}\n";
+            std::cout << "}";
+            if (report.weightedPI >= 0.0) {
+                std::cout << "  wPI: " << std::setprecision(4) << report.weightedPI;
+            }
+            std::cout << "\n";
         }
     }
-    else {
-        std::cout << "No patterns found.\n";
-   }
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+/**
+ * @file mapped_file.cpp
+ * @brief Implementation: Read-only whole-file memory mapping
+ */
+
+#include "mapped_file.h"
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string& path) {
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open file: " + path);
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		release();
+		throw std::runtime_error("Cannot read the size of file: " + path);
+	}
+	if (fileSize.QuadPart == 0) return;
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		release();
+		throw std::runtime_error("Cannot map file: " + path);
+	}
+	mappingHandle = mapping;
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		release();
+		throw std::runtime_error("Cannot map file: " + path);
+	}
+	bytes = static_cast<const char*>(view);
+	length = static_cast<size_t>(fileSize.QuadPart);
+};
+
+void MappedFile::release() {
+	if (bytes) UnmapViewOfFile(bytes);
+	if (mappingHandle) CloseHandle(static_cast<HANDLE>(mappingHandle));
+	if (fileHandle) CloseHandle(static_cast<HANDLE>(fileHandle));
+	bytes = nullptr;
+	length = 0;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+};
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) throw std::runtime_error("Cannot open file: " + path);
+
+	struct stat info;
+	if (::fstat(fd, &info) != 0) {
+		::close(fd);
+		throw std::runtime_error("Cannot read the size of file: " + path);
+	}
+	if (info.st_size == 0) {
+		::close(fd);
+		return;
+	}
+
+	// The mapping keeps its own reference to the file, so the descriptor can be closed
+	void* view = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED) throw std::runtime_error("Cannot map file: " + path);
+
+	::madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+	bytes = static_cast<const char*>(view);
+	length = static_cast<size_t>(info.st_size);
+};
+
+void MappedFile::release() {
+	if (bytes) ::munmap(const_cast<char*>(bytes), length);
+	bytes = nullptr;
+	length = 0;
+};
+
+#endif
+
+MappedFile::~MappedFile() {
+	release();
+};
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+	*this = std::move(other);
+};
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		release();
+		std::swap(bytes, other.bytes);
+		std::swap(length, other.length);
+#if defined(_WIN32)
+		std::swap(fileHandle, other.fileHandle);
+		std::swap(mappingHandle, other.mappingHandle);
+#endif
+	}
+	return *this;
+};
@@ -4,240 +4,664 @@
  */
 
 #include "maximal_clique_hashmap.h"
+#include "thread_pool.h"
+#include "bit_utils.h"
+#include "utils.h"
 #include <algorithm>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <thread>
+#include <numeric>
 #include <vector>
 #include <map>
 #include <set>
 
 namespace {
 
-	using NodeID = int; // Internal ID (0, 1, 2... N-1)
+	using NodeID = InstanceIndex; // Node = instance index (0, 1, 2... N-1)
 	using CliqueVec = std::vector<NodeID>;
 
-	// Union of two sorted vectors
-	CliqueVec set_union_helper(const CliqueVec& A, const CliqueVec& B) {
-		CliqueVec result;
-		result.reserve(A.size() + B.size());
-		std::set_union(A.begin(), A.end(), B.begin(), B.end(), std::back_inserter(result));
-		return result;
-	}
-
-	// Intersection of two sorted vectors
-	CliqueVec set_intersection_helper(const CliqueVec& A, const CliqueVec& B) {
-		CliqueVec result;
-		// Optimization: reserve distinct memory size based on smaller set
-		result.reserve(std::min(A.size(), B.size()));
-		std::set_intersection(A.begin(), A.end(), B.begin(), B.end(), std::back_inserter(result));
-		return result;
-	}
-
-	// Difference of two sorted vectors (A \ B)
-	CliqueVec set_difference_helper(const CliqueVec& A, const CliqueVec& B) {
-		CliqueVec result;
-		result.reserve(A.size());
-		std::set_difference(A.begin(), A.end(), B.begin(), B.end(), std::back_inserter(result));
-		return result;
-	}
-/**
-	     * @brief Standard Recursive Bron-Kerbosch with Pivot
-	     * Algorithm:
-	     * 1. Select pivot u from P U X (maximize |P n N(u)|)
-	     * 2. For each v in P \ N(u):
-	     * Recurse(R + v, P n N(v), X n N(v))
-	     * P = P - v
-	     * X = X + v
-	     */
-	int count_intersection(const CliqueVec& A, const CliqueVec& B) {
-		int i = 0, j = 0, count = 0;
-		while (i < A.size() && j < B.size()) {
-			if (A[i] == B[j]) { count++; i++; j++; }
-			else if (A[i] < B[j]) i++;
+	// Intersection of a sorted array with a sorted CSR row, written to out; returns its size
+	size_t intersect_into(const NodeID* A, size_t aSize, const NodeID* bFirst, const NodeID* bLast, NodeID* out) {
+		return std::set_intersection(A, A + aSize, bFirst, bLast, out) - out;
+	}
+
+	// Difference of a sorted array and a sorted CSR row (A \ B), written to out; returns its size
+	size_t difference_into(const NodeID* A, size_t aSize, const NodeID* bFirst, const NodeID* bLast, NodeID* out) {
+		return std::set_difference(A, A + aSize, bFirst, bLast, out) - out;
+	}
+
+	int count_intersection(const NodeID* A, size_t aSize, const NodeID* bFirst, const NodeID* bLast) {
+		size_t i = 0;
+		int count = 0;
+		const NodeID* j = bFirst;
+		while (i < aSize && j != bLast) {
+			if (A[i] == *j) { count++; i++; j++; }
+			else if (A[i] < *j) i++;
 			else j++;
 		}
 		return count;
 	}
 
-	void runBronKerbosch(
-		CliqueVec R,
-		CliqueVec P,
-		CliqueVec X,
-		const std::vector<std::vector<NodeID>>& adj,
-		std::vector<CliqueVec>& cliques)
-	{
-		if (P.empty() && X.empty()) {
-			if (R.size() >= 2) { // Only save cliques with size >= 2
-				cliques.push_back(R);
+	// Scratch state of one recursion depth; buffers are reused and only ever grow
+	struct DepthFrame {
+		std::vector<NodeID> P, X, candidates;
+		size_t pSize = 0, xSize = 0;
+		size_t numCandidates = 0, nextCandidate = 0;
+	};
+
+	/**
+	 * @brief Per-worker scratch arena for the iterative Bron-Kerbosch
+	 *
+	 * One frame per depth holds P, X and the candidate list. Buffers keep their capacity
+	 * across subproblems, so once every depth has reached its peak size the enumeration
+	 * makes no heap allocations. Each growth is counted in scratchAllocations.
+	 */
+	struct BKWorkspace {
+		std::vector<DepthFrame> frames;
+		std::vector<NodeID> R;
+		std::vector<NodeID> localNodes;       ///< Bitset kernel: local bit -> node
+		std::vector<uint64_t> bitAdjacency;   ///< Bitset kernel: W words per local node
+		uint64_t scratchAllocations = 0;
+		uint64_t bitsetSubproblems = 0;
+		uint64_t cliques = 0;
+
+		// Make buffer hold at least n entries (geometric growth)
+		template <typename T>
+		void reserve(std::vector<T>& buffer, size_t n) {
+			if (buffer.size() < n) {
+				buffer.resize(std::max(n, buffer.size() * 2));
+				++scratchAllocations;
 			}
-			return;
 		}
 
-		if (P.empty()) return;
-
-		// --- Pivot Selection Strategy ---
-		// Find pivot u in P U X that maximizes |P intersect N(u)|
-		// Why? To minimize the number of recursive calls (candidates = P \ N(u))
-
-		int u_pivot = -1;
+		// Frame of a depth, creating it on first use (invalidates references to other frames)
+		DepthFrame& frame(size_t depth) {
+			if (frames.size() <= depth) {
+				frames.resize(std::max(depth + 1, frames.size() * 2));
+				++scratchAllocations;
+			}
+			return frames[depth];
+		}
+	};
+
+	/**
+	 * @brief Select the pivot and fill the frame's candidates
+	 * Pivot u in P U X maximizes |P n N(u)|, which minimizes the branches (candidates = P \ N(u))
+	 */
+	void prepare_frame(DepthFrame& f, const CSRGraph& graph, BKWorkspace& ws) {
+		int64_t u_pivot = -1;
 		int max_intersection_size = -1;
 
 		// We can iterate over P and X separately to avoid creating a union vector
-		auto check_pivot = [&](int candidate_node) {
-			const auto& neighbors = adj[candidate_node];
-
-			int inter_size = count_intersection(P, neighbors);
-
+		auto check_pivot = [&](NodeID candidate_node) {
+			int inter_size = count_intersection(f.P.data(), f.pSize, graph.begin(candidate_node), graph.end(candidate_node));
 			if (inter_size > max_intersection_size) {
 				max_intersection_size = inter_size;
 				u_pivot = candidate_node;
 			}
 		};
+		for (size_t i = 0; i < f.pSize; ++i) check_pivot(f.P[i]);
+		for (size_t i = 0; i < f.xSize; ++i) check_pivot(f.X[i]);
+
+		ws.reserve(f.candidates, f.pSize);
+		NodeID u = static_cast<NodeID>(u_pivot);
+		f.numCandidates = difference_into(f.P.data(), f.pSize, graph.begin(u), graph.end(u), f.candidates.data());
+		f.nextCandidate = 0;
+	}
 
-		for (int node : P) check_pivot(node);
-		for (int node : X) check_pivot(node);
+	// Fixed-width bitset over the local indices of a small subproblem
+	template <size_t W>
+	struct LocalBits {
+		uint64_t words[W];
 
-		// --- Candidates Calculation: P \ N(pivot) ---
-		CliqueVec candidates;
-		if (u_pivot != -1) {
-			candidates = set_difference_helper(P, adj[u_pivot]);
+		static LocalBits fromRow(const uint64_t* row) {
+			LocalBits b;
+			for (size_t i = 0; i < W; ++i) b.words[i] = row[i];
+			return b;
 		}
-		else {
-			candidates = P;
+		bool none() const {
+			uint64_t any = 0;
+			for (size_t i = 0; i < W; ++i) any |= words[i];
+			return any == 0;
+		}
+		void set(size_t bit) { words[bit >> 6] |= uint64_t(1) << (bit & 63); }
+		void reset(size_t bit) { words[bit >> 6] &= ~(uint64_t(1) << (bit & 63)); }
+
+		// Call fn(bit) for every set bit, ascending
+		template <typename Fn>
+		void forEach(Fn&& fn) const {
+			for (size_t i = 0; i < W; ++i) {
+				for (uint64_t word = words[i]; word != 0; word &= word - 1) {
+					fn((i << 6) + countTrailingZeros64(word));
+				}
+			}
 		}
+	};
 
-		// --- Recursive Step ---
-		for (int v : candidates) {
-			CliqueVec newR = R;
-			newR.push_back(v);
+	template <size_t W>
+	LocalBits<W> operator&(const LocalBits<W>& a, const uint64_t* row) {
+		LocalBits<W> r;
+		for (size_t i = 0; i < W; ++i) r.words[i] = a.words[i] & row[i];
+		return r;
+	}
 
-			CliqueVec newP;
-			if (P.size() < adj[v].size())
-				newP = set_intersection_helper(P, adj[v]);
-			else
-				newP = set_intersection_helper(adj[v], P);
+	// |a & row| by word-wise AND plus popcount
+	template <size_t W>
+	int count_and(const LocalBits<W>& a, const uint64_t* row) {
+		int count = 0;
+		for (size_t i = 0; i < W; ++i) count += popcount64(a.words[i] & row[i]);
+		return count;
+	}
+
+	/**
+	 * @brief Bitset Bron-Kerbosch with Pivot on a remapped subproblem
+	 * Same algorithm as the frame-based version; adjacency rows are W words each, pivot
+	 * selection is a popcount loop and set operations are word-wise.
+	 */
+	template <size_t W, typename Emit>
+	void bitset_bron_kerbosch(
+		const uint64_t* adj, LocalBits<W> P, LocalBits<W> X,
+		const NodeID* localNodes, NodeID* R, size_t rSize, Emit& emit)
+	{
+		if (P.none()) {
+			if (X.none() && rSize >= 2) emit(R, rSize);
+			return;
+		}
 
-			CliqueVec newX;
-			if (X.size() < adj[v].size())
-				newX = set_intersection_helper(X, adj[v]);
-			else
-				newX = set_intersection_helper(adj[v], X);
+		size_t u_pivot = 0;
+		int max_intersection_size = -1;
+		auto check_pivot = [&](size_t u) {
+			int inter_size = count_and(P, adj + u * W);
+			if (inter_size > max_intersection_size) {
+				max_intersection_size = inter_size;
+				u_pivot = u;
+			}
+		};
+		P.forEach(check_pivot);
+		X.forEach(check_pivot);
+
+		// candidates = P \ N(pivot)
+		LocalBits<W> candidates;
+		for (size_t i = 0; i < W; ++i) candidates.words[i] = P.words[i] & ~adj[u_pivot * W + i];
+
+		candidates.forEach([&](size_t v) {
+			R[rSize] = localNodes[v];
+			bitset_bron_kerbosch<W>(adj, P & (adj + v * W), X & (adj + v * W), localNodes, R, rSize + 1, emit);
+			P.reset(v);
+			X.set(v);
+		});
+	}
 
-			runBronKerbosch(newR, newP, newX, adj, cliques);
+	// Remap a frame's P U X to local bits (P first, then X) and finish it with the bitset kernel
+	template <size_t W, typename Emit>
+	void solve_bitset_frame(const DepthFrame& f, size_t rSize, const CSRGraph& graph, BKWorkspace& ws, Emit& emit)
+	{
+		size_t k = f.pSize + f.xSize;
+		ws.reserve(ws.localNodes, k);
+		std::copy(f.P.data(), f.P.data() + f.pSize, ws.localNodes.data());
+		std::copy(f.X.data(), f.X.data() + f.xSize, ws.localNodes.data() + f.pSize);
+
+		// Row of local node i: its neighbors among P (bits [0, pSize)) and X (bits [pSize, k))
+		ws.reserve(ws.bitAdjacency, k * W);
+		uint64_t* adj = ws.bitAdjacency.data();
+		std::fill(adj, adj + k * W, uint64_t(0));
+		for (size_t i = 0; i < k; ++i) {
+			NodeID g = ws.localNodes[i];
+			uint64_t* row = adj + i * W;
+			auto mark = [&](const NodeID* set, size_t size, size_t bitOffset) {
+				const NodeID* a = set;
+				const NodeID* aEnd = set + size;
+				const NodeID* b = graph.begin(g);
+				const NodeID* bEnd = graph.end(g);
+				while (a != aEnd && b != bEnd) {
+					if (*a == *b) {
+						size_t bit = bitOffset + (a - set);
+						row[bit >> 6] |= uint64_t(1) << (bit & 63);
+						++a; ++b;
+					}
+					else if (*a < *b) ++a;
+					else ++b;
+				}
+			};
+			mark(f.P.data(), f.pSize, 0);
+			mark(f.X.data(), f.xSize, f.pSize);
 		}
+
+		LocalBits<W> P{}, X{};
+		for (size_t i = 0; i < f.pSize; ++i) P.set(i);
+		for (size_t i = f.pSize; i < k; ++i) X.set(i);
+
+		// The clique can grow by at most |P| vertices
+		ws.reserve(ws.R, rSize + f.pSize);
+		++ws.bitsetSubproblems;
+		bitset_bron_kerbosch<W>(adj, P, X, ws.localNodes.data(), ws.R.data(), rSize, emit);
 	}
-}
 
-// ============================================================================
-// PUBLIC METHODS IMPLEMENTATION
-// ============================================================================
+	// Finish the frame with the bitset kernel if |P U X| <= bitsetMax (at most 256)
+	template <typename Emit>
+	bool solve_small_frame(const DepthFrame& f, size_t rSize, size_t bitsetMax, const CSRGraph& graph, BKWorkspace& ws, Emit& emit)
+	{
+		size_t k = f.pSize + f.xSize;
+		if (k > bitsetMax) return false;
 
-// Although named "executeDivBK" to keep interface compatibility, 
-// this now runs the Standard Recursive Bron-Kerbosch algorithm.
-std::vector<ColocationInstance> MaximalCliqueHashmap::executeDivBK(
-	const std::vector<NeighborSet>& neighborSets) {
+		if (k <= 64) solve_bitset_frame<1>(f, rSize, graph, ws, emit);
+		else if (k <= 128) solve_bitset_frame<2>(f, rSize, graph, ws, emit);
+		else solve_bitset_frame<4>(f, rSize, graph, ws, emit);
+		return true;
+	}
 
-	// --- Step 1: Mapping SpatialInstance* to Integer ID (0..N-1) ---
-	std::map<std::pair<FeatureType, InstanceID>, int> uniqueNodeMap;
-	std::vector<const SpatialInstance*> internalToInstance;
-	int nextInternalID = 0;
+	/**
+	 * @brief Iterative Bron-Kerbosch with Pivot over an explicit stack of DepthFrames
+	 * Algorithm (per frame):
+	 * 1. Select pivot u from P U X (maximize |P n N(u)|)
+	 * 2. For each v in P \ N(u):
+	 * Descend(R + v, P n N(v), X n N(v))
+	 * P = P - v
+	 * X = X + v
+	 *
+	 * The caller fills frame 0 (sorted P and X, with X able to hold |P| + |X|) and R[0].
+	 * emit(R, size) is called for every maximal clique of size >= 2.
+	 * Any frame whose |P U X| is at most bitsetMax is finished by the bitset kernel.
+	 */
+	template <typename Emit>
+	void runBronKerbosch(const CSRGraph& graph, size_t bitsetMax, BKWorkspace& ws, Emit&& emit)
+	{
+		size_t depth = 0;
+		size_t rSize = 1;
 
-	auto getInternalID = [&](const SpatialInstance* inst) {
-		std::pair<FeatureType, InstanceID> key = { inst->type, inst->id };
-		if (uniqueNodeMap.find(key) == uniqueNodeMap.end()) {
-			uniqueNodeMap[key] = nextInternalID++;
-			internalToInstance.push_back(inst);
-		}
-		return uniqueNodeMap[key];
-		};
+		DepthFrame& root = ws.frame(0);
+		if (root.pSize == 0) return; // R = {v} alone is never reported
+		if (solve_small_frame(root, rSize, bitsetMax, graph, ws, emit)) return;
 
-	// --- Step 2: Build Adjacency List (Dense Graph) ---
-	std::vector<std::set<int>> tempAdj;
-	for (const auto& ns : neighborSets) {
-		int u = getInternalID(ns.center);
-		if (tempAdj.size() <= u) tempAdj.resize(u + 1);
+		prepare_frame(root, graph, ws);
 
-		for (const SpatialInstance* neighbor : ns.neighbors) {
-			int v = getInternalID(neighbor);
-			if (tempAdj.size() <= v) tempAdj.resize(v + 1);
+		while (true) {
+			if (ws.frames[depth].nextCandidate == ws.frames[depth].numCandidates) {
+				if (depth == 0) break;
+				--depth;
+				--rSize;
+				continue;
+			}
 
-			if (u != v) {
-				tempAdj[u].insert(v);
-				tempAdj[v].insert(u);
+			DepthFrame& child = ws.frame(depth + 1);
+			DepthFrame& f = ws.frames[depth];
+			NodeID v = f.candidates[f.nextCandidate++];
+
+			// Child sets: P n N(v) and X n N(v) (X sized for later P -> X moves)
+			ws.reserve(child.P, f.pSize);
+			ws.reserve(child.X, f.pSize + f.xSize);
+			child.pSize = intersect_into(f.P.data(), f.pSize, graph.begin(v), graph.end(v), child.P.data());
+			child.xSize = intersect_into(f.X.data(), f.xSize, graph.begin(v), graph.end(v), child.X.data());
+
+			// P = P - v, X = X + v (both kept sorted in place)
+			NodeID* pEnd = f.P.data() + f.pSize;
+			NodeID* pPos = std::lower_bound(f.P.data(), pEnd, v);
+			std::move(pPos + 1, pEnd, pPos);
+			--f.pSize;
+
+			NodeID* xEnd = f.X.data() + f.xSize;
+			NodeID* xPos = std::lower_bound(f.X.data(), xEnd, v);
+			std::move_backward(xPos, xEnd, xEnd + 1);
+			*xPos = v;
+			++f.xSize;
+
+			ws.reserve(ws.R, rSize + 1);
+			ws.R[rSize++] = v;
+
+			if (child.pSize == 0) {
+				if (child.xSize == 0) {
+					emit(ws.R.data(), rSize); // rSize >= 2 below the root
+				}
+				--rSize;
+				continue;
 			}
+
+			if (solve_small_frame(child, rSize, bitsetMax, graph, ws, emit)) {
+				--rSize;
+				continue;
+			}
+
+			prepare_frame(child, graph, ws);
+			++depth;
 		}
 	}
 
-	int num_nodes = internalToInstance.size();
-	std::vector<std::vector<int>> adj(num_nodes);
-	for (int i = 0; i < num_nodes; ++i) {
-		if (i < tempAdj.size()) {
-			adj[i].assign(tempAdj[i].begin(), tempAdj[i].end());
+	/**
+	 * @brief Connected components of the graph, isolated vertices dropped
+	 * Component c is nodes[starts[c], starts[c + 1]) in BFS order; localIndex maps a
+	 * non-isolated vertex to its offset inside its component.
+	 */
+	struct Components {
+		std::vector<NodeID> nodes;
+		std::vector<size_t> starts;
+		std::vector<NodeID> localIndex;
+
+		size_t count() const { return starts.size() - 1; }
+		size_t size(size_t c) const { return starts[c + 1] - starts[c]; }
+	};
+
+	Components connectedComponents(const CSRGraph& graph) {
+		const NodeID unvisited = std::numeric_limits<NodeID>::max();
+		size_t n = graph.numNodes();
+
+		Components comps;
+		comps.localIndex.assign(n, unvisited);
+		comps.starts.push_back(0);
+		for (size_t s = 0; s < n; ++s) {
+			NodeID seed = static_cast<NodeID>(s);
+			if (graph.degree(seed) == 0 || comps.localIndex[seed] != unvisited) continue;
+
+			// BFS with the component's slice of nodes as the queue
+			size_t start = comps.nodes.size();
+			comps.localIndex[seed] = 0;
+			comps.nodes.push_back(seed);
+			for (size_t head = start; head < comps.nodes.size(); ++head) {
+				NodeID v = comps.nodes[head];
+				for (const NodeID* it = graph.begin(v); it != graph.end(v); ++it) {
+					if (comps.localIndex[*it] != unvisited) continue;
+					comps.localIndex[*it] = static_cast<NodeID>(comps.nodes.size() - start);
+					comps.nodes.push_back(*it);
+				}
+			}
+			comps.starts.push_back(comps.nodes.size());
 		}
+		return comps;
 	}
 
-	// --- Step 3: Prepare Initial Sets for BK ---
-	CliqueVec R;
-	CliqueVec P(num_nodes); // All nodes [0, 1, ... N-1]
-	for (int i = 0; i < num_nodes; ++i) P[i] = i;
-	CliqueVec X;
+	/**
+	 * @brief Degeneracy (smallest-last) ordering via Batagelj-Zaversnik bucket peeling
+	 *
+	 * Repeatedly removes a vertex of minimum remaining degree. Every vertex then has at
+	 * most d (the graph degeneracy) neighbors later in the order.
+	 * Works on one component: nodes[0, count) is reordered in place and localIndex (the
+	 * offsets produced by connectedComponents) indexes the per-call arrays.
+	 */
+	void degeneracyOrder(const CSRGraph& graph, NodeID* nodes, size_t count, const std::vector<NodeID>& localIndex) {
+		std::vector<size_t> degree(count);
+		size_t maxDegree = 0;
+		for (size_t i = 0; i < count; ++i) {
+			degree[localIndex[nodes[i]]] = graph.degree(nodes[i]);
+			maxDegree = std::max(maxDegree, degree[localIndex[nodes[i]]]);
+		}
 
-	std::vector<CliqueVec> resultIDs;
+		// Bucket start positions by degree
+		std::vector<size_t> binStart(maxDegree + 1, 0);
+		for (size_t v = 0; v < count; ++v) binStart[degree[v]]++;
+		size_t start = 0;
+		for (size_t d = 0; d <= maxDegree; ++d) {
+			size_t binCount = binStart[d];
+			binStart[d] = start;
+			start += binCount;
+		}
 
-	// --- Step 4: Run Recursive Algorithm ---
-	runBronKerbosch(R, P, X, adj, resultIDs);
+		// Local vertices sorted by degree, and each vertex's position in that array
+		std::vector<NodeID> order(count);
+		std::vector<size_t> position(count);
+		for (size_t v = 0; v < count; ++v) {
+			position[v] = binStart[degree[v]]++;
+			order[position[v]] = static_cast<NodeID>(v);
+		}
+		for (size_t d = maxDegree; d > 0; --d) binStart[d] = binStart[d - 1];
+		binStart[0] = 0;
+
+		// Local offsets back to graph nodes (nodes[] is about to be overwritten)
+		std::vector<NodeID> global(count);
+		for (size_t i = 0; i < count; ++i) global[localIndex[nodes[i]]] = nodes[i];
+
+		// Peel: moving a neighbor to the front of its bucket and shrinking the bucket
+		// decrements its degree in O(1)
+		for (size_t i = 0; i < count; ++i) {
+			NodeID v = order[i];
+			NodeID gv = global[v];
+			for (const NodeID* it = graph.begin(gv); it != graph.end(gv); ++it) {
+				NodeID u = localIndex[*it];
+				if (degree[u] > degree[v]) {
+					size_t du = degree[u];
+					size_t pu = position[u];
+					size_t pw = binStart[du];
+					NodeID w = order[pw];
+					if (u != w) {
+						order[pu] = w;
+						order[pw] = u;
+						position[u] = pw;
+						position[w] = pu;
+					}
+					binStart[du]++;
+					degree[u]--;
+				}
+			}
+		}
 
-	// --- Step 5: Convert Integer IDs back to ColocationInstance ---
-	std::vector<ColocationInstance> finalResult;
-	finalResult.reserve(resultIDs.size());
+		for (size_t i = 0; i < count; ++i) nodes[i] = global[order[i]];
+	}
+}
+
+MaximalCliqueHashmap::MaximalCliqueHashmap(int numThreads, int bitsetMaxVertices)
+	: numThreads(numThreads),
+	bitsetMaxVertices(bitsetMaxVertices) {
+}
+
+// Workers used by enumerateCliques (numThreads resolved against the hardware)
+size_t MaximalCliqueHashmap::workerCount() const {
+	if (numThreads > 0) return static_cast<size_t>(numThreads);
+	return std::max(1u, std::thread::hardware_concurrency());
+}
 
-	for (const auto& clique : resultIDs) {
-		ColocationInstance col;
-		col.reserve(clique.size());
-		for (int id : clique) {
-			col.push_back(internalToInstance[id]);
+// ============================================================================
+// PUBLIC METHODS IMPLEMENTATION
+// ============================================================================
+
+// Although named "executeDivBK" to keep interface compatibility, 
+// this now runs an iterative Bron-Kerbosch with pivoting under the Eppstein-Loffler-Strash outer loop:
+// vertices are taken in degeneracy order and each vertex v solves an independent
+// subproblem with R = {v}, P = later neighbors, X = earlier neighbors. Every maximal
+// clique is reported exactly once, by its earliest vertex.
+// Isolated vertices are dropped and each connected component is ordered and solved on
+// its own, largest first, since no clique spans two components.
+// The CSR graph is consumed as-is: its nodes are instance indices and its rows are sorted.
+// Cliques are handed to visit as they are found; nothing is collected here.
+void MaximalCliqueHashmap::enumerateCliques(const CSRGraph& graph, const CliqueVisitor& visit) {
+
+	// --- Step 1: Connected Components (largest first) ---
+	Components comps = connectedComponents(graph);
+	std::vector<size_t> componentOrder(comps.count());
+	std::iota(componentOrder.begin(), componentOrder.end(), size_t(0));
+	std::stable_sort(componentOrder.begin(), componentOrder.end(),
+		[&](size_t a, size_t b) { return comps.size(a) > comps.size(b); });
+
+	// Degeneracy rank of each vertex; only compared between vertices of one component
+	std::vector<size_t> rank(graph.numNodes());
+
+	// Bitset kernel covers up to 4 words (256 vertices); 0 disables it
+	size_t bitsetMax = static_cast<size_t>(std::min(std::max(bitsetMaxVertices, 0), 256));
+
+	// --- Step 2: Per-vertex Subproblem (P and X stay sorted because CSR rows are) ---
+	auto solveVertex = [&](NodeID v, BKWorkspace& ws, size_t workerId) {
+		size_t degree = graph.degree(v);
+		DepthFrame& root = ws.frame(0);
+		ws.reserve(root.P, degree);
+		ws.reserve(root.X, degree);
+		root.pSize = root.xSize = 0;
+		for (const NodeID* it = graph.begin(v); it != graph.end(v); ++it) {
+			if (rank[*it] > rank[v]) root.P[root.pSize++] = *it;
+			else root.X[root.xSize++] = *it;
 		}
-		finalResult.push_back(col);
+
+		ws.reserve(ws.R, 1);
+		ws.R[0] = v;
+		runBronKerbosch(graph, bitsetMax, ws, [&](const NodeID* R, size_t size) {
+			++ws.cliques;
+			visit(R, size, workerId);
+		});
+	};
+
+	// Order one component in place and write its ranks
+	auto orderComponent = [&](size_t c) {
+		NodeID* nodes = comps.nodes.data() + comps.starts[c];
+		degeneracyOrder(graph, nodes, comps.size(c), comps.localIndex);
+		for (size_t i = 0; i < comps.size(c); ++i) rank[nodes[i]] = i;
+	};
+
+	// --- Step 3: Run Components (work stealing balances the skewed dense areas) ---
+	std::vector<BKWorkspace> workspaces(workerCount());
+	if (workspaces.size() == 1) {
+		for (size_t c : componentOrder) {
+			orderComponent(c);
+			for (size_t i = comps.starts[c]; i < comps.starts[c + 1]; ++i) {
+				solveVertex(comps.nodes[i], workspaces[0], 0);
+			}
+		}
+	}
+	else {
+		// Components up to this size run as one task; larger ones fan out per vertex
+		const size_t kSplitComponentSize = 64;
+
+		WorkStealingPool pool(static_cast<int>(workspaces.size()));
+		for (size_t c : componentOrder) {
+			pool.submit([&, c](size_t workerId) {
+				orderComponent(c);
+				if (comps.size(c) <= kSplitComponentSize) {
+					for (size_t i = comps.starts[c]; i < comps.starts[c + 1]; ++i) {
+						solveVertex(comps.nodes[i], workspaces[workerId], workerId);
+					}
+					return;
+				}
+				for (size_t i = comps.starts[c]; i < comps.starts[c + 1]; ++i) {
+					NodeID v = comps.nodes[i];
+					pool.submit([&, v](size_t worker) { solveVertex(v, workspaces[worker], worker); });
+				}
+			});
+		}
+		pool.wait();
+	}
+
+	stats = BKStats();
+	stats.components = comps.count();
+	stats.subproblems = comps.nodes.size();
+	for (const BKWorkspace& ws : workspaces) {
+		stats.cliques += ws.cliques;
+		stats.scratchAllocations += ws.scratchAllocations;
+		stats.bitsetSubproblems += ws.bitsetSubproblems;
 	}
+}
+
+// Enumerate maximal cliques into one vector (per-worker vectors merged at the end)
+std::vector<ColocationInstance> MaximalCliqueHashmap::executeDivBK(const CSRGraph& graph) {
+	std::vector<std::vector<CliqueVec>> workerCliques(workerCount());
+	enumerateCliques(graph, [&](const InstanceIndex* clique, size_t size, size_t workerId) {
+		workerCliques[workerId].emplace_back(clique, clique + size);
+	});
 
-	return finalResult;
+	// Node IDs already are instance indices, so the cliques are returned as-is
+	std::vector<CliqueVec> resultIDs;
+	size_t total = 0;
+	for (const auto& cliques : workerCliques) total += cliques.size();
+	resultIDs.reserve(total);
+	for (auto& cliques : workerCliques) {
+		std::move(cliques.begin(), cliques.end(), std::back_inserter(resultIDs));
+		std::vector<CliqueVec>().swap(cliques);
+	}
+	return resultIDs;
 }
 
-// Build instance hashmap from maximal cliques (Remains unchanged logic)
-std::map<Colocation, std::map<FeatureType, std::set<const SpatialInstance*>>> MaximalCliqueHashmap::buildInstanceHash(
-	const std::vector<NeighborSet>& neighborSets) {
+// Build instance hashmap over the whole dataset
+template <size_t W>
+InstanceHashMap<W> MaximalCliqueHashmap::buildInstanceHash(
+	const CSRGraph& graph,
+	const InstanceStore& instances) {
 
-	std::vector<ColocationInstance> bk_result = MaximalCliqueHashmap::executeDivBK(neighborSets);
-	std::map<Colocation, std::map<FeatureType, std::set<const SpatialInstance*>>> hashMap;
+	InstanceHashMap<W> hashMap;
+	addInstanceHash<W>(graph, instances, countFeaturesById(instances), CliqueFilter(), hashMap);
+	return hashMap;
+}
 
-	// Process each clique
-	for (const auto& clique : bk_result) {
-		// Build colocation key
-		Colocation colocationKey;
-		colocationKey.reserve(clique.size());
-		for (const auto& instancePtr : clique) {
-			colocationKey.push_back(instancePtr->type);
+// Fold each clique in as it is emitted
+// Every worker fills its own map; the maps are merged into hashMap once enumeration is
+// done, so memory follows the hashmap size rather than the number of cliques.
+template <size_t W>
+void MaximalCliqueHashmap::addInstanceHash(
+	const CSRGraph& graph,
+	const InstanceStore& instances,
+	const std::vector<int>& featureCounts,
+	const CliqueFilter& keep,
+	InstanceHashMap<W>& hashMap) {
+
+	std::vector<InstanceHashMap<W>> workerMaps(workerCount());
+
+	enumerateCliques(graph, [&](const InstanceIndex* clique, size_t size, size_t workerId) {
+		if (keep && !keep(clique, size)) return;
+
+		// Build colocation key (one bit per feature ID)
+		ColocationMask<W> colocationKey;
+		for (size_t i = 0; i < size; ++i) {
+			colocationKey.set(instances.featureId[clique[i]]);
 		}
 
-		std::sort(colocationKey.begin(), colocationKey.end());
+		// Insert instances (as ranks within their feature) into hashmap
+		auto& featureMap = workerMaps[workerId][colocationKey];
+		for (size_t i = 0; i < size; ++i) {
+			FeatureID f = instances.featureId[clique[i]];
+			featureMap.try_emplace(f, static_cast<uint32_t>(featureCounts[f])).first->second.add(instances.featureRank[clique[i]]);
+		}
+	});
 
-		// Insert instances into hashmap
-		for (const auto& instancePtr : clique) {
-			hashMap[colocationKey][instancePtr->type].insert(instancePtr);
+	for (auto& workerMap : workerMaps) {
+		for (auto& entry : workerMap) {
+			for (auto& feature : entry.second) feature.second.compact();
 		}
 	}
 
-	return hashMap;
+	// Merge per-worker maps (the first one is moved in if hashMap is still empty)
+	size_t firstMerged = 0;
+	if (hashMap.empty()) {
+		hashMap = std::move(workerMaps[0]);
+		firstMerged = 1;
+	}
+	for (size_t w = firstMerged; w < workerMaps.size(); ++w) {
+		for (auto& entry : workerMaps[w]) {
+			auto& featureMap = hashMap[entry.first];
+			for (auto& feature : entry.second) {
+				featureMap[feature.first].unionWith(feature.second);
+			}
+		}
+		InstanceHashMap<W>().swap(workerMaps[w]);
+	}
 }
 
 // Extract initial candidate colocations from hashmap (Remains unchanged logic)
-std::priority_queue<Colocation, std::vector<Colocation>, ColocationPriorityComp> MaximalCliqueHashmap::extractInitialCandidates(
-	const std::map<Colocation, std::map<FeatureType, std::set<const SpatialInstance*>>>& hashMap) {
+template <size_t W>
+CandidateQueue<W> MaximalCliqueHashmap::extractInitialCandidates(
+	const InstanceHashMap<W>& hashMap) {
 
-	std::priority_queue<Colocation, std::vector<Colocation>, ColocationPriorityComp> candidateQueue;
+	CandidateQueue<W> candidateQueue;
 	for (const auto& entry : hashMap) {
-		const Colocation& maximalClique = entry.first;
+		const ColocationMask<W>& maximalClique = entry.first;
 		candidateQueue.push(maximalClique);
 	}
 	return candidateQueue;
-}
\ No newline at end of file
+}
+
+// Key widths used by main: 1, 2 and 4 words, then 16, 64, 256 and 1024 (see kMaxMaskWords)
+template InstanceHashMap<1> MaximalCliqueHashmap::buildInstanceHash<1>(const CSRGraph&, const InstanceStore&);
+template InstanceHashMap<2> MaximalCliqueHashmap::buildInstanceHash<2>(const CSRGraph&, const InstanceStore&);
+template InstanceHashMap<4> MaximalCliqueHashmap::buildInstanceHash<4>(const CSRGraph&, const InstanceStore&);
+template InstanceHashMap<16> MaximalCliqueHashmap::buildInstanceHash<16>(const CSRGraph&, const InstanceStore&);
+template InstanceHashMap<64> MaximalCliqueHashmap::buildInstanceHash<64>(const CSRGraph&, const InstanceStore&);
+template InstanceHashMap<256> MaximalCliqueHashmap::buildInstanceHash<256>(const CSRGraph&, const InstanceStore&);
+template InstanceHashMap<1024> MaximalCliqueHashmap::buildInstanceHash<1024>(const CSRGraph&, const InstanceStore&);
+template void MaximalCliqueHashmap::addInstanceHash<1>(const CSRGraph&, const InstanceStore&, const std::vector<int>&, const CliqueFilter&, InstanceHashMap<1>&);
+template void MaximalCliqueHashmap::addInstanceHash<2>(const CSRGraph&, const InstanceStore&, const std::vector<int>&, const CliqueFilter&, InstanceHashMap<2>&);
+template void MaximalCliqueHashmap::addInstanceHash<4>(const CSRGraph&, const InstanceStore&, const std::vector<int>&, const CliqueFilter&, InstanceHashMap<4>&);
+template void MaximalCliqueHashmap::addInstanceHash<16>(const CSRGraph&, const InstanceStore&, const std::vector<int>&, const CliqueFilter&, InstanceHashMap<16>&);
+template void MaximalCliqueHashmap::addInstanceHash<64>(const CSRGraph&, const InstanceStore&, const std::vector<int>&, const CliqueFilter&, InstanceHashMap<64>&);
+template void MaximalCliqueHashmap::addInstanceHash<256>(const CSRGraph&, const InstanceStore&, const std::vector<int>&, const CliqueFilter&, InstanceHashMap<256>&);
+template void MaximalCliqueHashmap::addInstanceHash<1024>(const CSRGraph&, const InstanceStore&, const std::vector<int>&, const CliqueFilter&, InstanceHashMap<1024>&);
+template CandidateQueue<1> MaximalCliqueHashmap::extractInitialCandidates<1>(const InstanceHashMap<1>&);
+template CandidateQueue<2> MaximalCliqueHashmap::extractInitialCandidates<2>(const InstanceHashMap<2>&);
+template CandidateQueue<4> MaximalCliqueHashmap::extractInitialCandidates<4>(const InstanceHashMap<4>&);
+template CandidateQueue<16> MaximalCliqueHashmap::extractInitialCandidates<16>(const InstanceHashMap<16>&);
+template CandidateQueue<64> MaximalCliqueHashmap::extractInitialCandidates<64>(const InstanceHashMap<64>&);
+template CandidateQueue<256> MaximalCliqueHashmap::extractInitialCandidates<256>(const InstanceHashMap<256>&);
+template CandidateQueue<1024> MaximalCliqueHashmap::extractInitialCandidates<1024>(const InstanceHashMap<1024>&);
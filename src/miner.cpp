@@ -5,153 +5,610 @@
 
 #include "miner.h"
 #include "utils.h"
+#include "participation_table.h"
 #include <vector>
 #include <queue>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include "thread_pool.h"
+
+
+namespace {
+
+	/**
+	 * @brief Deduplicating set of masks safe for concurrent insert
+	 * Masks are spread over independently locked shards by hash.
+	 */
+	template <size_t W>
+	class ShardedMaskSet {
+	private:
+		struct Shard {
+			std::mutex mutex;
+			std::unordered_set<ColocationMask<W>, FeatureBitsetHash> masks;
+		};
+		std::vector<Shard> shards;
+
+	public:
+		explicit ShardedMaskSet(size_t numShards) : shards(numShards) {}
+
+		void insert(const ColocationMask<W>& mask) {
+			// High hash bits pick the shard, low bits stay spread within it
+			Shard& shard = shards[(FeatureBitsetHash()(mask) >> 20) % shards.size()];
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.masks.insert(mask);
+		}
+
+		// Move every mask out (not thread-safe; call between levels)
+		std::vector<ColocationMask<W>> drain() {
+			std::vector<ColocationMask<W>> all;
+			for (Shard& shard : shards) {
+				all.insert(all.end(), shard.masks.begin(), shard.masks.end());
+				std::unordered_set<ColocationMask<W>, FeatureBitsetHash>().swap(shard.masks);
+			}
+			return all;
+		}
+	};
 
+	// Approximate heap bytes of a participation result (map nodes plus bitmap buffers)
+	size_t instancesBytes(const FeatureInstances& instances) {
+		size_t bytes = 0;
+		for (const auto& feature : instances) bytes += 64 + feature.second.memoryBytes();
+		return bytes;
+	}
+}
+
+/**
+ * @brief Participating instances of already evaluated patterns, kept for their subsets
+ *
+ * Candidates are evaluated largest first, so the parents (size k + 1) of a size k
+ * candidate are all evaluated before it. The cache keeps two generations: the parents
+ * of the level being mined (read-only meanwhile, so workers may share them) and the
+ * patterns of the current level. Starting the next level drops the parent generation,
+ * whose subsets are then all processed. New entries are refused once the current
+ * generation exceeds the byte budget.
+ */
+template <size_t W>
+class ParticipationCache {
+private:
+	using Generation = std::unordered_map<ColocationMask<W>, FeatureInstances, FeatureBitsetHash>;
+	Generation parents;
+	Generation current;
+	std::vector<std::vector<const typename Generation::value_type*>> parentsWith;  ///< Feature -> parents holding it
+	size_t parentSize = 0;
+	size_t currentBytes = 0;
+	size_t budgetBytes;
+	size_t numFeatures;
+
+public:
+	ParticipationCache(size_t budgetBytes, size_t numFeatures)
+		: budgetBytes(budgetBytes), numFeatures(numFeatures) {}
+
+	// Start the level below: current becomes the parent generation
+	void nextLevel() {
+		parents.swap(current);
+		Generation().swap(current);
+		currentBytes = 0;
+
+		parentsWith.assign(numFeatures, {});
+		parentSize = parents.empty() ? 0 : parents.begin()->first.count();
+		for (const auto& entry : parents) {
+			entry.first.forEach([&](size_t f) { parentsWith[f].push_back(&entry); });
+		}
+	}
+
+	// A cached parent c + {f}; sets removed = f
+	const FeatureInstances* findParent(const ColocationMask<W>& c, size_t& removed) const {
+		size_t size = c.count();
+		if (parents.empty() || parentSize != size + 1) return nullptr;
+
+		// Every parent holds all of c's features: test those holding c's least common one
+		// when they are fewer than the features to probe (wide dictionaries)
+		const std::vector<const typename Generation::value_type*>* fewest = nullptr;
+		c.forEach([&](size_t f) {
+			if (!fewest || parentsWith[f].size() < fewest->size()) fewest = &parentsWith[f];
+		});
+		if (fewest && fewest->size() < numFeatures - size) {
+			for (const auto* entry : *fewest) {
+				if (!c.isSubsetOf(entry->first)) continue;
+				entry->first.forEach([&](size_t f) { if (!c.test(f)) removed = f; });
+				return &entry->second;
+			}
+			return nullptr;
+		}
+
+		ColocationMask<W> parent = c;
+		for (size_t f = 0; f < numFeatures; ++f) {
+			if (c.test(f)) continue;
+			parent.set(f);
+			auto it = parents.find(parent);
+			if (it != parents.end()) {
+				removed = f;
+				return &it->second;
+			}
+			parent.reset(f);
+		}
+		return nullptr;
+	}
+
+	// Keep c's participating instances for its subsets (refused over budget)
+	void insert(const ColocationMask<W>& c, FeatureInstances&& instances) {
+		size_t bytes = instancesBytes(instances);
+		if (currentBytes + bytes > budgetBytes) return;
+		currentBytes += bytes;
+		current.emplace(c, std::move(instances));
+	}
+};
 
 // Main mining algorithm: find all prevalent colocation patterns
-std::set<Colocation> Miner::minePCPs(
-	std::priority_queue<Colocation, std::vector<Colocation>, ColocationPriorityComp>& candidateColocations,
-	const std::map<Colocation, std::map<FeatureType, std::set<const SpatialInstance*>>>& hashMap,
-	const std::map<FeatureType, int>& featureCounts,
-	double delta,
+template <size_t W>
+std::set<ColocationMask<W>> Miner::minePCPs(
+	CandidateQueue<W>& candidateColocations,
+	const InstanceHashMap<W>& hashMap,
+	const std::vector<int>& featureCounts,
+	const RareWeightTable& weights,
 	double min_prev) {
 
-	std::set<Colocation> prevalentPCs;
-	std::set<Colocation> nonPrevalentPCs;
-	std::set<Colocation> visited;
+	ParticipationSource<W> source = buildSource(hashMap, featureCounts.size());
+	ParticipationCache<W>* cache = source.cache.get();
+	if (numThreads != 1) {
+		return mineLevelsParallel(candidateColocations, source, featureCounts, weights, min_prev);
+	}
+
+	std::set<ColocationMask<W>> prevalentPCs;
+	std::unordered_set<ColocationMask<W>, FeatureBitsetHash> visited;
+	CandidateScratch scratch;
+	size_t levelSize = 0;
 
 	while (!candidateColocations.empty()) {
-		Colocation c = candidateColocations.top();
+		ColocationMask<W> c = candidateColocations.top();
 		candidateColocations.pop();
 
-		if (visited.count(c)) continue;
-		visited.insert(c);
+		if (!visited.insert(c).second) continue;
 
-		std::set<Colocation> newCs;
-
-		auto partInstances = queryInstances(c, hashMap);
-		auto rareIntensityMap = calcRareIntensity(c, featureCounts, delta);
+		if (cache && c.count() != levelSize) {
+			levelSize = c.count();
+			cache->nextLevel();
+		}
 
-		double weightedPI = computeWeightedPI(partInstances, c, rareIntensityMap, featureCounts);
-		newCs = generateSubsets(c);
+		std::vector<ColocationMask<W>> newCs = generateSubsets(c);
 
-		if (weightedPI >= min_prev) {
+		// A bound below the threshold settles the candidate without a superset query
+		bool evaluated = !source.index ||
+			pairwiseUpperBound(c, featureCounts, weights, scratch) >= min_prev;
+		if (evaluated && evaluateWeightedPI(c, source, featureCounts, weights, scratch) >= min_prev) {
 			prevalentPCs.insert(c);
 
-			auto prevalentSubsets = deducePrevalentSubsets(newCs, c, featureCounts);
-			for (const auto& subset : prevalentSubsets) {
-				prevalentPCs.insert(subset);
-			}
-
-			std::set<Colocation> filteredSubsets;
+			// Lemma 2: If C is prevalent, any subset C' containing f_min is also prevalent.
+			size_t f_min = findMinFeature(c, featureCounts);
+			std::vector<ColocationMask<W>> filteredSubsets;
 			for (const auto& subset : newCs) {
-				if (!prevalentSubsets.count(subset)) {
-					filteredSubsets.insert(subset);
-				}
+				if (subset.test(f_min)) prevalentPCs.insert(subset);
+				else filteredSubsets.push_back(subset);
 			}
-			newCs = filteredSubsets;
-		}
-		else {
-			nonPrevalentPCs.insert(c);
+			newCs.swap(filteredSubsets);
 		}
 
+		bool pushed = false;
 		for (const auto& subset : newCs) {
 			if (!visited.count(subset)) {
 				candidateColocations.push(subset);
+				pushed = true;
 			}
 		}
+		if (cache && pushed && evaluated) cache->insert(c, std::move(scratch.instances));
 	}
 
 	return prevalentPCs;
 }
 
+// Multi-threshold mode: one traversal of the union of the candidates any threshold
+// reaches. A subset that Lemma 2 settles under threshold t is also settled under every
+// lower one (a parent prevalent at t is prevalent below it), so the thresholds reaching a
+// candidate are always the sorted thresholds from some index on. Each candidate keeps
+// only that index, and its bound or weighted PI is computed once for all of them.
+template <size_t W>
+std::vector<std::set<ColocationMask<W>>> Miner::minePCPsMulti(
+	const CandidateQueue<W>& candidateColocations,
+	const InstanceHashMap<W>& hashMap,
+	const std::vector<int>& featureCounts,
+	const RareWeightTable& weights,
+	const std::vector<double>& thresholds) {
+
+	std::vector<double> sorted(thresholds);
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+	std::vector<std::set<ColocationMask<W>>> found(sorted.size());
+	if (sorted.empty()) return found;
+
+	ParticipationSource<W> source = buildSource(hashMap, featureCounts.size());
+	ParticipationCache<W>* cache = source.cache.get();
+	CandidateScratch scratch;
+	size_t levelSize = 0;
+
+	// Pending candidates -> lowest index into sorted that reaches them (seeds: all)
+	std::unordered_map<ColocationMask<W>, size_t, FeatureBitsetHash> reachedFrom;
+	CandidateQueue<W> candidates = candidateColocations;
+	for (CandidateQueue<W> seeds = candidateColocations; !seeds.empty(); seeds.pop()) {
+		reachedFrom[seeds.top()] = 0;
+	}
 
-// Query instances of a colocation from hashmap
-std::map<FeatureType, std::set<const SpatialInstance*>> Miner::queryInstances(
-	Colocation c,
-	const std::map<Colocation, std::map<FeatureType, std::set<const SpatialInstance*>>>& hashMap) {
-		//////// TODO: Implement (10)/////////
+	while (!candidates.empty()) {
+		ColocationMask<W> c = candidates.top();
+		candidates.pop();
 
-	std::map<FeatureType, std::set<const SpatialInstance*>> instancesMap;
+		auto pending = reachedFrom.find(c);
+		if (pending == reachedFrom.end()) continue;
+		size_t from = pending->second;
+		reachedFrom.erase(pending);
 
-	for (const auto& entry : hashMap) {
-		const Colocation& maximalClique = entry.first;
-		const auto& cliqueInstances = entry.second;
+		if (cache && c.count() != levelSize) {
+			levelSize = c.count();
+			cache->nextLevel();
+		}
 
-		// Check if c is a subset of maximalClique
-		bool isSubset = true;
-		for (const auto& f : c) {
-			bool found = false;
-			for (const auto& mf : maximalClique) {
-				if (mf == f) {
-					found = true;
-					break;
-				}
-			}
-			if (!found) {
-				isSubset = false;
-				break;
+		// Thresholds [from, upTo) find c prevalent; a bound below sorted[from] rejects them all
+		bool evaluated = !source.index ||
+			pairwiseUpperBound(c, featureCounts, weights, scratch) >= sorted[from];
+		size_t upTo = from;
+		if (evaluated) {
+			double weightedPI = evaluateWeightedPI(c, source, featureCounts, weights, scratch);
+			while (upTo < sorted.size() && weightedPI >= sorted[upTo]) ++upTo;
+		}
+		size_t f_min = upTo > from ? findMinFeature(c, featureCounts) : SIZE_MAX;
+		for (size_t t = from; t < upTo; ++t) found[t].insert(c);
+
+		bool pushed = false;
+		for (const auto& subset : generateSubsets(c)) {
+			// Lemma 2: If C is prevalent, any subset C' containing f_min is also prevalent.
+			size_t subsetFrom = from;
+			if (upTo > from && subset.test(f_min)) {
+				for (size_t t = from; t < upTo; ++t) found[t].insert(subset);
+				subsetFrom = upTo;
 			}
+			if (subsetFrom == sorted.size()) continue;
+
+			auto reached = reachedFrom.emplace(subset, subsetFrom);
+			if (reached.second) candidates.push(subset);
+			else reached.first->second = std::min(reached.first->second, subsetFrom);
+			pushed = true;
 		}
+		if (cache && pushed && evaluated) cache->insert(c, std::move(scratch.instances));
+	}
+
+	std::vector<std::set<ColocationMask<W>>> results;
+	results.reserve(thresholds.size());
+	for (double min_prev : thresholds) {
+		size_t t = std::lower_bound(sorted.begin(), sorted.end(), min_prev) - sorted.begin();
+		results.push_back(found[t]);
+	}
+	return results;
+}
+
+// Level-wise parallel traversal: every candidate of size k is evaluated concurrently, the
+// size k - 1 subsets they generate are deduplicated in a sharded set, then the next level
+// starts. Candidates of one size never influence each other in the serial loop (subsets
+// are always smaller, so none of them is visited yet), which makes the result identical.
+template <size_t W>
+std::set<ColocationMask<W>> Miner::mineLevelsParallel(
+	CandidateQueue<W>& candidateColocations,
+	const ParticipationSource<W>& source,
+	const std::vector<int>& featureCounts,
+	const RareWeightTable& weights,
+	double min_prev) {
+
+	ParticipationCache<W>* cache = source.cache.get();
+
+	// Seed candidates (maximal keys) grouped by size
+	std::vector<std::vector<ColocationMask<W>>> seeds;
+	while (!candidateColocations.empty()) {
+		const ColocationMask<W>& c = candidateColocations.top();
+		size_t k = c.count();
+		if (seeds.size() <= k) seeds.resize(k + 1);
+		seeds[k].push_back(c);
+		candidateColocations.pop();
+	}
 
-		// If c is a subset, merge instances
-		if (isSubset) {
-			for (const auto& f : c) {
-				if (cliqueInstances.count(f)) {
-					const auto& insts = cliqueInstances.at(f);
-					instancesMap[f].insert(insts.begin(), insts.end());
+	WorkStealingPool pool(numThreads);
+	std::vector<CandidateScratch> scratch(pool.size());
+	std::vector<std::vector<ColocationMask<W>>> workerPrevalent(pool.size());
+	ShardedMaskSet<W> nextLevel(pool.size() * 8);
+
+	// Results to cache for the next level, collected per worker and inserted between levels
+	std::vector<std::vector<std::pair<ColocationMask<W>, FeatureInstances>>> workerCached(pool.size());
+
+	std::vector<ColocationMask<W>> level;
+	for (size_t k = seeds.empty() ? 0 : seeds.size() - 1; k >= 2; --k) {
+		for (const auto& c : seeds[k]) nextLevel.insert(c);
+		level = nextLevel.drain();
+
+		const size_t chunk = std::max<size_t>(1, level.size() / (pool.size() * 8));
+		for (size_t begin = 0; begin < level.size(); begin += chunk) {
+			size_t end = std::min(level.size(), begin + chunk);
+			pool.submit([&, begin, end](size_t workerId) {
+				for (size_t i = begin; i < end; ++i) {
+					const ColocationMask<W>& c = level[i];
+					std::vector<ColocationMask<W>> newCs = generateSubsets(c);
+
+					bool evaluated = !source.index ||
+						pairwiseUpperBound(c, featureCounts, weights, scratch[workerId]) >= min_prev;
+					bool prevalent = evaluated &&
+						evaluateWeightedPI(c, source, featureCounts, weights, scratch[workerId]) >= min_prev;
+					size_t f_min = prevalent ? findMinFeature(c, featureCounts) : SIZE_MAX;
+					if (prevalent) workerPrevalent[workerId].push_back(c);
+
+					// Lemma 2: If C is prevalent, any subset C' containing f_min is also prevalent.
+					bool pushed = false;
+					for (const auto& subset : newCs) {
+						if (prevalent && subset.test(f_min)) workerPrevalent[workerId].push_back(subset);
+						else {
+							nextLevel.insert(subset);
+							pushed = true;
+						}
+					}
+					if (cache && pushed && evaluated) workerCached[workerId].emplace_back(c, std::move(scratch[workerId].instances));
 				}
+			});
+		}
+		pool.wait();
+
+		// This level's entries become the parents of the next one
+		if (cache) {
+			for (auto& entries : workerCached) {
+				for (auto& entry : entries) cache->insert(entry.first, std::move(entry.second));
+				entries.clear();
+			}
+			cache->nextLevel();
+		}
+	}
+
+	std::set<ColocationMask<W>> prevalentPCs;
+	for (const auto& patterns : workerPrevalent) {
+		prevalentPCs.insert(patterns.begin(), patterns.end());
+	}
+	return prevalentPCs;
+}
+
+// Top-k traversal: same candidate order as minePCPs, but every subset is pushed (no
+// Lemma 2 deduction, since deduced patterns have no PI to rank). Once k patterns are
+// held, the k-th best PI is the bar: a candidate whose upper bound stays below it is
+// skipped without computing its participating instances.
+template <size_t W>
+std::vector<std::pair<ColocationMask<W>, double>> Miner::mineTopK(
+	CandidateQueue<W>& candidateColocations,
+	const InstanceHashMap<W>& hashMap,
+	const std::vector<int>& featureCounts,
+	const RareWeightTable& weights,
+	size_t k) {
+
+	using Scored = std::pair<ColocationMask<W>, double>;
+	std::vector<Scored> ranked;
+	if (k == 0) return ranked;
+
+	// a ranks above b
+	auto better = [](const Scored& a, const Scored& b) {
+		if (a.second != b.second) return a.second > b.second;
+		size_t sizeA = a.first.count();
+		size_t sizeB = b.first.count();
+		if (sizeA != sizeB) return sizeA > sizeB;
+		return lexicographicLess(a.first, b.first);
+	};
+	// Bounded heap with the worst of the current top k on top
+	std::priority_queue<Scored, std::vector<Scored>, decltype(better)> best(better);
+
+	ParticipationSource<W> source = buildSource(hashMap, featureCounts.size());
+	ParticipationCache<W>* cache = source.cache.get();
+	std::unordered_set<ColocationMask<W>, FeatureBitsetHash> visited;
+	CandidateScratch scratch;
+	size_t levelSize = 0;
+
+	while (!candidateColocations.empty()) {
+		ColocationMask<W> c = candidateColocations.top();
+		candidateColocations.pop();
+
+		if (!visited.insert(c).second) continue;
+
+		if (cache && c.count() != levelSize) {
+			levelSize = c.count();
+			cache->nextLevel();
+		}
+
+		bool pushed = false;
+		for (const auto& subset : generateSubsets(c)) {
+			if (!visited.count(subset)) {
+				candidateColocations.push(subset);
+				pushed = true;
 			}
 		}
+
+		// Table lookups are exact already; only superset queries are worth bounding
+		// (the pairwise bound first, it needs no lookup at all)
+		if (best.size() == k && source.index &&
+			(pairwiseUpperBound(c, featureCounts, weights, scratch) < best.top().second ||
+			weightedPIUpperBound(c, *source.index, featureCounts, weights, scratch) < best.top().second)) {
+			continue;
+		}
+
+		Scored scored(c, evaluateWeightedPI(c, source, featureCounts, weights, scratch));
+		if (cache && pushed) cache->insert(c, std::move(scratch.instances));
+
+		if (best.size() < k) best.push(scored);
+		else if (better(scored, best.top())) {
+			best.pop();
+			best.push(scored);
+		}
+	}
+
+	ranked.reserve(best.size());
+	while (!best.empty()) {
+		ranked.push_back(best.top());
+		best.pop();
+	}
+	std::reverse(ranked.begin(), ranked.end());
+	return ranked;
+}
+
+// Build the participation structures the engine needs
+template <size_t W>
+Miner::ParticipationSource<W> Miner::buildSource(const InstanceHashMap<W>& hashMap, size_t numFeatures) {
+	// Per-candidate superset queries, or one table built up front
+	ParticipationSource<W> source;
+	if (engine == MiningEngine::Zeta) source.table = std::make_unique<ParticipationTable<W>>(hashMap);
+	else source.index = std::make_unique<SupersetIndex<W>>(hashMap, numFeatures);
+
+	// Parents' results seed their subsets' queries (the zeta table needs no queries)
+	if (source.index && cacheBytes > 0) source.cache = std::make_unique<ParticipationCache<W>>(cacheBytes, numFeatures);
+	return source;
+}
+
+// Upper bound of c's weighted PI: per feature, the summed instance counts of the keys
+// containing c (>= the size of their union), capped at the feature's total count
+template <size_t W>
+double Miner::weightedPIUpperBound(
+	const ColocationMask<W>& c,
+	const SupersetIndex<W>& index,
+	const std::vector<int>& featureCounts,
+	const RareWeightTable& weights,
+	CandidateScratch& scratch) {
+
+	std::vector<uint32_t>& bound = scratch.participation;
+	bound.assign(c.count(), 0);
+	index.findSupersets(c, scratch.matches);
+	for (uint32_t ordinal : scratch.matches) {
+		const FeatureInstances& cliqueInstances = index.entry(ordinal);
+		size_t i = 0;
+		c.forEach([&](size_t f) {
+			auto it = cliqueInstances.find(static_cast<FeatureID>(f));
+			if (it != cliqueInstances.end()) bound[i] += static_cast<uint32_t>(it->second.count());
+			++i;
+		});
+	}
+
+	size_t i = 0;
+	c.forEach([&](size_t f) {
+		bound[i] = std::min(bound[i], static_cast<uint32_t>(featureCounts[f]));
+		++i;
+	});
+	return computeWeightedPI(bound, c, weights, featureCounts);
+};
+
+// Upper bound of c's weighted PI: per feature fi, the fewest fi instances having a
+// neighbor of any single other feature of c, capped at fi's total count
+template <size_t W>
+double Miner::pairwiseUpperBound(
+	const ColocationMask<W>& c,
+	const std::vector<int>& featureCounts,
+	const RareWeightTable& weights,
+	CandidateScratch& scratch) {
+
+	if (!pairwise) return std::numeric_limits<double>::infinity();
+
+	std::vector<uint32_t>& bound = scratch.participation;
+	bound.clear();
+	c.forEach([&](size_t fi) {
+		uint32_t count = static_cast<uint32_t>(featureCounts[fi]);
+		c.forEach([&](size_t fj) {
+			if (fj != fi) count = std::min(count, pairwise->count(fi, fj));
+		});
+		bound.push_back(count);
+	});
+	return computeWeightedPI(bound, c, weights, featureCounts);
+};
+
+// Weighted PI of c (participation from the index or the table)
+template <size_t W>
+double Miner::evaluateWeightedPI(
+	const ColocationMask<W>& c,
+	const ParticipationSource<W>& source,
+	const std::vector<int>& featureCounts,
+	const RareWeightTable& weights,
+	CandidateScratch& scratch) {
+
+	// Participating instance count of each feature of c, ascending
+	std::vector<uint32_t>& participation = scratch.participation;
+	participation.assign(c.count(), 0);
+	if (source.table) {
+		const uint32_t* counts = source.table->find(c);
+		if (counts) std::copy(counts, counts + participation.size(), participation.begin());
+	}
+	else {
+		size_t removed = 0;
+		const FeatureInstances* parent = source.cache ? source.cache->findParent(c, removed) : nullptr;
+		scratch.instances = queryInstances(c, *source.index, scratch.matches, parent, removed);
+		size_t i = 0;
+		c.forEach([&](size_t f) {
+			auto it = scratch.instances.find(static_cast<FeatureID>(f));
+			if (it != scratch.instances.end()) participation[i] = static_cast<uint32_t>(it->second.count());
+			++i;
+		});
+	}
+	return computeWeightedPI(participation, c, weights, featureCounts);
+};
+
+
+// Query instances of a colocation from the hashmap keys that contain it
+template <size_t W>
+FeatureInstances Miner::queryInstances(
+	const ColocationMask<W>& c,
+	const SupersetIndex<W>& index,
+	std::vector<uint32_t>& matches,
+	const FeatureInstances* parent,
+	size_t removed) {
+		//////// TODO: Implement (10)/////////
+
+	FeatureInstances instancesMap;
+
+	// Keys containing the parent already contributed to its result
+	if (parent) {
+		for (const auto& feature : *parent) {
+			if (feature.first != removed) instancesMap.emplace(feature.first, feature.second);
+		}
+	}
+
+	// Only maximal cliques with c as a subset contribute instances
+	index.findSupersets(c, matches, parent ? removed : SIZE_MAX);
+	for (uint32_t ordinal : matches) {
+		const auto& cliqueInstances = index.entry(ordinal);
+		c.forEach([&](size_t f) {
+			auto it = cliqueInstances.find(static_cast<FeatureID>(f));
+			if (it != cliqueInstances.end()) {
+				instancesMap[it->first].unionWith(it->second);
+			}
+		});
 	}
 
 	return instancesMap;
 };
 
 // Compute weighted participation index for a colocation
+template <size_t W>
 double Miner::computeWeightedPI(
-	const std::map<FeatureType, std::set<const SpatialInstance*>>& partInstances,
-	Colocation c,
-	const std::unordered_map<FeatureType, double>& rareIntensityMap,
-	const std::map<FeatureType, int>& featureCounts) {
+	const std::vector<uint32_t>& participation,
+	const ColocationMask<W>& c,
+	const RareWeightTable& weights,
+	const std::vector<int>& featureCounts) {
 		//////// TODO: Implement (12)/////////
 	if (c.empty()) return 0.0;
+	const double* weightRow = weights.row(findMinFeature(c, featureCounts));
 	
 	double minWPR = -1.0;
+	size_t i = 0;
 
-	for (const auto& f : c) {
+	c.forEach([&](size_t f) {
 		// Calculate PR = count / N
-		int count = 0;
-		if (partInstances.count(f)) {
-			count = partInstances.at(f).size();
-		}
+		int count = static_cast<int>(participation[i++]);
 
-		int totalCount = 0;
-		if (featureCounts.count(f)) {
-			totalCount = featureCounts.at(f);
-		}
-
-		if (totalCount == 0) continue;
+		int totalCount = featureCounts[f];
+		if (totalCount == 0) return;
 
 		double pr = static_cast<double>(count) / totalCount;
 
-		// Retrieve RI
-		double ri = 1.0; // Default if missing? Or should skip? 
-		// If RI is missing, it implies error or skip. 
-		// According to logic, RI depends on featureCounts. If >0 count, RI exists.
-		if (rareIntensityMap.count(f)) {
-			ri = rareIntensityMap.at(f);
-		}
-
-		// Calculate W_log = 1 / RI
-		double w_log = 0.0;
-		if (ri > 1e-9) {
-			w_log = 1.0 / ri;
-		}
+		// W_log = 1 / RI, precomputed for (f_min, f)
+		double w_log = weights.weight(weightRow, f);
 
 		// WPR = PR * W_log
 		double wpr = pr * w_log;
@@ -159,66 +616,63 @@ double Miner::computeWeightedPI(
 		if (minWPR < 0 || wpr < minWPR) {
 			minWPR = wpr;
 		}
-	}
+	});
 
 	return (minWPR < 0) ? 0.0 : minWPR;
 };
 
 // Generate all size-1 subsets (remove one feature at a time)
-std::set<Colocation> Miner::generateSubsets(const Colocation& c) {
-	std::set<Colocation> subsets;
-	if (c.size() <= 2) return subsets;
-
-	for (size_t i = 0; i < c.size(); ++i) {
-		Colocation sub = c;
-		sub.erase(sub.begin() + i);
-		subsets.insert(sub);
-	}
+template <size_t W>
+std::vector<ColocationMask<W>> Miner::generateSubsets(const ColocationMask<W>& c) {
+	std::vector<ColocationMask<W>> subsets;
+	if (c.count() <= 2) return subsets;
+
+	c.forEach([&](size_t f) {
+		ColocationMask<W> sub = c;
+		sub.reset(f);
+		subsets.push_back(sub);
+	});
 	return subsets;
 };
 
-// Deduce prevalent subsets using downward closure property
-std::set<Colocation> Miner::deducePrevalentSubsets(
-	std::set<Colocation>& subsets,
-	const Colocation& c,
-	const std::map<FeatureType, int>& featureCounts) {
+// f_min: feature with min frequency in c (ties go to the smallest ID, i.e. name)
+template <size_t W>
+size_t Miner::findMinFeature(
+	const ColocationMask<W>& c,
+	const std::vector<int>& featureCounts) {
 	
-	std::set<Colocation> provenPrevalent;
-	
-	// 1. Find f_min (feature with min frequency) in parent c
-	FeatureType f_min;
+	size_t f_min = 0;
 	int minCount = -1;
 
-	for (const auto& f : c) {
-		int count = 0;
-		if (featureCounts.count(f)) {
-			count = featureCounts.at(f);
-		}
-		
+	c.forEach([&](size_t f) {
+		int count = featureCounts[f];
 		if (minCount == -1 || count < minCount) {
 			minCount = count;
 			f_min = f;
-		} else if (count == minCount) {
-			// Optional tie-breaker
-			if (f < f_min) f_min = f;
 		}
-	}
-
-	// 2. Lemma 2: If C is prevalent, any subset C' containing f_min is also prevalent.
-	if (!f_min.empty()) {
-		for (const auto& subset : subsets) {
-			bool hasMinFeature = false;
-			for (const auto& f : subset) {
-				if (f == f_min) {
-					hasMinFeature = true;
-					break;
-				}
-			}
+	});
+	return f_min;
+};
 
-			if (hasMinFeature) {
-				provenPrevalent.insert(subset);
-			}
-		}
-	}
-	return provenPrevalent;
-};
\ No newline at end of file
+// Mask widths used by main: 1, 2 and 4 words, then 16, 64, 256 and 1024 (see kMaxMaskWords)
+template std::set<ColocationMask<1>> Miner::minePCPs<1>(CandidateQueue<1>&, const InstanceHashMap<1>&, const std::vector<int>&, const RareWeightTable&, double);
+template std::set<ColocationMask<2>> Miner::minePCPs<2>(CandidateQueue<2>&, const InstanceHashMap<2>&, const std::vector<int>&, const RareWeightTable&, double);
+template std::set<ColocationMask<4>> Miner::minePCPs<4>(CandidateQueue<4>&, const InstanceHashMap<4>&, const std::vector<int>&, const RareWeightTable&, double);
+template std::set<ColocationMask<16>> Miner::minePCPs<16>(CandidateQueue<16>&, const InstanceHashMap<16>&, const std::vector<int>&, const RareWeightTable&, double);
+template std::set<ColocationMask<64>> Miner::minePCPs<64>(CandidateQueue<64>&, const InstanceHashMap<64>&, const std::vector<int>&, const RareWeightTable&, double);
+template std::set<ColocationMask<256>> Miner::minePCPs<256>(CandidateQueue<256>&, const InstanceHashMap<256>&, const std::vector<int>&, const RareWeightTable&, double);
+template std::set<ColocationMask<1024>> Miner::minePCPs<1024>(CandidateQueue<1024>&, const InstanceHashMap<1024>&, const std::vector<int>&, const RareWeightTable&, double);
+template std::vector<std::pair<ColocationMask<1>, double>> Miner::mineTopK<1>(CandidateQueue<1>&, const InstanceHashMap<1>&, const std::vector<int>&, const RareWeightTable&, size_t);
+template std::vector<std::pair<ColocationMask<2>, double>> Miner::mineTopK<2>(CandidateQueue<2>&, const InstanceHashMap<2>&, const std::vector<int>&, const RareWeightTable&, size_t);
+template std::vector<std::pair<ColocationMask<4>, double>> Miner::mineTopK<4>(CandidateQueue<4>&, const InstanceHashMap<4>&, const std::vector<int>&, const RareWeightTable&, size_t);
+template std::vector<std::pair<ColocationMask<16>, double>> Miner::mineTopK<16>(CandidateQueue<16>&, const InstanceHashMap<16>&, const std::vector<int>&, const RareWeightTable&, size_t);
+template std::vector<std::pair<ColocationMask<64>, double>> Miner::mineTopK<64>(CandidateQueue<64>&, const InstanceHashMap<64>&, const std::vector<int>&, const RareWeightTable&, size_t);
+template std::vector<std::pair<ColocationMask<256>, double>> Miner::mineTopK<256>(CandidateQueue<256>&, const InstanceHashMap<256>&, const std::vector<int>&, const RareWeightTable&, size_t);
+template std::vector<std::pair<ColocationMask<1024>, double>> Miner::mineTopK<1024>(CandidateQueue<1024>&, const InstanceHashMap<1024>&, const std::vector<int>&, const RareWeightTable&, size_t);
+template std::vector<std::set<ColocationMask<1>>> Miner::minePCPsMulti<1>(const CandidateQueue<1>&, const InstanceHashMap<1>&, const std::vector<int>&, const RareWeightTable&, const std::vector<double>&);
+template std::vector<std::set<ColocationMask<2>>> Miner::minePCPsMulti<2>(const CandidateQueue<2>&, const InstanceHashMap<2>&, const std::vector<int>&, const RareWeightTable&, const std::vector<double>&);
+template std::vector<std::set<ColocationMask<4>>> Miner::minePCPsMulti<4>(const CandidateQueue<4>&, const InstanceHashMap<4>&, const std::vector<int>&, const RareWeightTable&, const std::vector<double>&);
+template std::vector<std::set<ColocationMask<16>>> Miner::minePCPsMulti<16>(const CandidateQueue<16>&, const InstanceHashMap<16>&, const std::vector<int>&, const RareWeightTable&, const std::vector<double>&);
+template std::vector<std::set<ColocationMask<64>>> Miner::minePCPsMulti<64>(const CandidateQueue<64>&, const InstanceHashMap<64>&, const std::vector<int>&, const RareWeightTable&, const std::vector<double>&);
+template std::vector<std::set<ColocationMask<256>>> Miner::minePCPsMulti<256>(const CandidateQueue<256>&, const InstanceHashMap<256>&, const std::vector<int>&, const RareWeightTable&, const std::vector<double>&);
+template std::vector<std::set<ColocationMask<1024>>> Miner::minePCPsMulti<1024>(const CandidateQueue<1024>&, const InstanceHashMap<1024>&, const std::vector<int>&, const RareWeightTable&, const std::vector<double>&);
\ No newline at end of file
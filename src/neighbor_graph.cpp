@@ -4,90 +4,298 @@
  */
 
 #include "neighbor_graph.h"
+#include "distance_kernel.h"
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <algorithm>
+#include <iterator>
 #include <unordered_map>
+#include <thread>
 
-// Calculate Euclidean distance between two spatial instances
-double NeighborGraph::euclideanDist(const SpatialInstance& a, const SpatialInstance& b) {
-	return std::sqrt(std::pow(a.x - b.x, 2) + std::pow(a.y - b.y, 2));
+namespace {
+
+	// Run task(t) for every t in [0, numTasks) on its own thread (the caller runs task 0)
+	template <typename Task>
+	void runOnThreads(size_t numTasks, Task task) {
+		std::vector<std::thread> workers;
+		workers.reserve(numTasks);
+		for (size_t t = 1; t < numTasks; ++t) {
+			workers.emplace_back(task, t);
+		}
+		task(0);
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	// Concatenate per-thread buffers in thread order
+	template <typename T>
+	std::vector<T> concatBuffers(std::vector<std::vector<T>>& buffers) {
+		size_t total = 0;
+		for (const auto& buffer : buffers) total += buffer.size();
+
+		std::vector<T> merged;
+		merged.reserve(total);
+		for (auto& buffer : buffers) {
+			std::move(buffer.begin(), buffer.end(), std::back_inserter(merged));
+			std::vector<T>().swap(buffer);
+		}
+		return merged;
+	}
+}
+
+NeighborGraph::NeighborGraph(JoinMethod method, int numThreads)
+	: joinMethod(method),
+	numThreads(numThreads > 0 ? numThreads : std::max(1u, std::thread::hardware_concurrency())),
+	distanceKernel(selectDistanceKernel()) {
+}
+
+// Find all neighbor pairs within distance threshold using the configured engine
+std::vector<std::pair<InstanceIndex, InstanceIndex>> NeighborGraph::findNeighborPair(
+	const InstanceStore& instances,
+	double distanceThreshold) {
+	if (joinMethod == JoinMethod::Grid) {
+		return gridJoin(instances, distanceThreshold);
+	}
+	return planeSweepJoin(instances, distanceThreshold);
 };
 
-// Find all neighbor pairs within distance threshold
-std::vector<std::pair<SpatialInstance, SpatialInstance>> NeighborGraph::findNeighborPair(
-	const std::vector<SpatialInstance>& instances,
+// Plane sweep: sort by X and scan forward while the X gap is within threshold.
+// With several threads the sorted instances are cut into contiguous X-slabs; each
+// thread sweeps the points of its slab and may read up to distanceThreshold past the
+// slab end (the overlap), so every pair is still produced exactly once by its left point.
+std::vector<std::pair<InstanceIndex, InstanceIndex>> NeighborGraph::planeSweepJoin(
+	const InstanceStore& instances,
 	double distanceThreshold) {
 	/// using plan sweep
-	std::vector<std::pair<SpatialInstance, SpatialInstance>> pairs;
 
-	// Create a copy to sort by X coordinate for Plane Sweep
-	std::vector<SpatialInstance> sortedInstances = instances;
-	std::sort(sortedInstances.begin(), sortedInstances.end(),
-		[](const SpatialInstance& a, const SpatialInstance& b) {
-			return a.x < b.x;
+	// Sort instance indices by X coordinate for Plane Sweep
+	size_t n = instances.size();
+	std::vector<InstanceIndex> sortedOrder(n);
+	for (size_t i = 0; i < n; ++i) sortedOrder[i] = static_cast<InstanceIndex>(i);
+	std::sort(sortedOrder.begin(), sortedOrder.end(),
+		[&](InstanceIndex a, InstanceIndex b) {
+			return instances.x[a] < instances.x[b];
 		});
 
-	// Plane Sweep Algorithm
-	for (size_t i = 0; i < sortedInstances.size(); ++i) {
-		for (size_t j = i + 1; j < sortedInstances.size(); ++j) {
-			// Optimization: Break if X distance exceeds threshold
-			if (sortedInstances[j].x - sortedInstances[i].x > distanceThreshold) {
-				break;
+	size_t numSlabs = std::max<size_t>(1, std::min<size_t>(numThreads, n));
+	std::vector<std::vector<std::pair<InstanceIndex, InstanceIndex>>> slabPairs(numSlabs);
+
+	// Contiguous X-sorted copies of the columns keep the sweep's inner loop on sequential memory
+	std::vector<double> sortedX(n), sortedY(n);
+	std::vector<FeatureID> sortedFeature(n);
+	for (size_t i = 0; i < n; ++i) {
+		sortedX[i] = instances.x[sortedOrder[i]];
+		sortedY[i] = instances.y[sortedOrder[i]];
+		sortedFeature[i] = instances.featureId[sortedOrder[i]];
+	}
+
+	// Squared bound that accepts exactly the pairs with sqrt(dx^2 + dy^2) <= distanceThreshold
+	double maxSquaredDist = squaredDistanceBound(distanceThreshold);
+
+	// Plane Sweep Algorithm (over the outer points of one slab)
+	auto sweepSlab = [&](size_t slab) {
+		size_t begin = n * slab / numSlabs;
+		size_t end = n * (slab + 1) / numSlabs;
+		auto& pairs = slabPairs[slab];
+		std::vector<uint32_t> hits;
+
+		// windowEnd = first point whose X gap to point i exceeds threshold (never moves back)
+		size_t windowEnd = begin;
+		for (size_t i = begin; i < end; ++i) {
+			windowEnd = std::max(windowEnd, i + 1);
+			while (windowEnd < n && !(sortedX[windowEnd] - sortedX[i] > distanceThreshold)) {
+				++windowEnd;
 			}
 
-			// Check Y distance
-			if (std::abs(sortedInstances[j].y - sortedInstances[i].y) <= distanceThreshold) {
-				// Check exact Euclidean distance
-				if (euclideanDist(sortedInstances[i], sortedInstances[j]) <= distanceThreshold &&
-					sortedInstances[i].type != sortedInstances[j].type) {
-					pairs.push_back({ sortedInstances[i], sortedInstances[j] });
-				}
+			// Filter the whole X window in blocks (distance and feature checks)
+			size_t count = windowEnd - (i + 1);
+			if (hits.size() < count) hits.resize(count);
+			size_t numHits = distanceKernel(
+				sortedX[i], sortedY[i], sortedFeature[i],
+				&sortedX[i + 1], &sortedY[i + 1], &sortedFeature[i + 1], count,
+				maxSquaredDist, hits.data());
+
+			for (size_t h = 0; h < numHits; ++h) {
+				pairs.push_back({ sortedOrder[i], sortedOrder[i + 1 + hits[h]] });
 			}
 		}
+	};
+
+	runOnThreads(numSlabs, sweepSlab);
+
+	// Slabs are in X order, so concatenation reproduces the serial pair sequence
+	return concatBuffers(slabPairs);
+};
+
+// Uniform grid join: bucket instances into square cells of side distanceThreshold.
+// Any neighbor pair then lies in the same or an adjacent cell, so each cell is compared
+// with itself and the forward half of its 3x3 neighborhood (each pair is seen once).
+std::vector<std::pair<InstanceIndex, InstanceIndex>> NeighborGraph::gridJoin(
+	const InstanceStore& instances,
+	double distanceThreshold) {
+	std::vector<std::pair<InstanceIndex, InstanceIndex>> pairs;
+	if (instances.size() == 0) return pairs;
+
+	// A non-positive threshold cannot define a cell size; the sweep handles it exactly
+	if (!(distanceThreshold > 0.0)) {
+		return planeSweepJoin(instances, distanceThreshold);
+	}
+
+	auto xRange = std::minmax_element(instances.x.begin(), instances.x.end());
+	auto yRange = std::minmax_element(instances.y.begin(), instances.y.end());
+	double minX = *xRange.first, maxX = *xRange.second;
+	double minY = *yRange.first, maxY = *yRange.second;
+
+	double maxSquaredDist = squaredDistanceBound(distanceThreshold);
+
+	// Widen the cell by a relative epsilon so rounding in the division can never
+	// place two points within the threshold more than one cell apart
+	double cellSize = distanceThreshold * (1.0 + 1e-9);
+
+	// Cell coordinates are packed into one 64-bit key; fall back if they cannot fit
+	const double maxCells = static_cast<double>(std::numeric_limits<uint32_t>::max() - 1);
+	if ((maxX - minX) / cellSize >= maxCells || (maxY - minY) / cellSize >= maxCells) {
+		return planeSweepJoin(instances, distanceThreshold);
 	}
-	return pairs;
+
+	auto cellKey = [](uint64_t cx, uint64_t cy) { return (cx << 32) | cy; };
+
+	// 1. Assign every instance to a cell and sort so each cell is a contiguous range
+	struct CellEntry {
+		uint64_t key;
+		InstanceIndex index;
+	};
+	std::vector<CellEntry> entries(instances.size());
+	for (size_t i = 0; i < instances.size(); ++i) {
+		uint64_t cx = static_cast<uint64_t>((instances.x[i] - minX) / cellSize);
+		uint64_t cy = static_cast<uint64_t>((instances.y[i] - minY) / cellSize);
+		entries[i] = { cellKey(cx, cy), static_cast<InstanceIndex>(i) };
+	}
+	std::sort(entries.begin(), entries.end(),
+		[](const CellEntry& a, const CellEntry& b) {
+			return a.key < b.key || (a.key == b.key && a.index < b.index);
+		});
+
+	// Cell-ordered copies of the columns so every cell is a contiguous block for the kernel
+	std::vector<double> cellX(entries.size()), cellY(entries.size());
+	std::vector<FeatureID> cellFeature(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		cellX[i] = instances.x[entries[i].index];
+		cellY[i] = instances.y[entries[i].index];
+		cellFeature[i] = instances.featureId[entries[i].index];
+	}
+
+	// 2. Index cell key -> [begin, end) range in the sorted entries
+	std::vector<uint64_t> cellKeys;
+	std::vector<size_t> cellStarts;
+	std::unordered_map<uint64_t, std::pair<size_t, size_t>> cells;
+	cells.reserve(entries.size());
+	for (size_t i = 0; i < entries.size();) {
+		size_t j = i;
+		while (j < entries.size() && entries[j].key == entries[i].key) ++j;
+		cells[entries[i].key] = { i, j };
+		cellKeys.push_back(entries[i].key);
+		cellStarts.push_back(i);
+		i = j;
+	}
+
+	// Forward half of the 3x3 stencil (the same cell is handled separately)
+	const int forward[4][2] = { { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+	// 3. Join each cell with itself and its forward neighbors; with several threads
+	// the cells are split into contiguous runs holding about the same number of points
+	size_t numChunks = std::max<size_t>(1, std::min<size_t>(numThreads, cellKeys.size()));
+	std::vector<std::vector<std::pair<InstanceIndex, InstanceIndex>>> chunkPairs(numChunks);
+
+	auto joinChunk = [&](size_t chunk) {
+		auto& pairs = chunkPairs[chunk];
+		size_t lo = entries.size() * chunk / numChunks;
+		size_t hi = entries.size() * (chunk + 1) / numChunks;
+
+		std::vector<uint32_t> hits;
+
+		// Compare entry a with the contiguous entries [first, last)
+		auto joinBlock = [&](size_t a, size_t first, size_t last) {
+			size_t count = last - first;
+			if (hits.size() < count) hits.resize(count);
+			size_t numHits = distanceKernel(
+				cellX[a], cellY[a], cellFeature[a],
+				&cellX[first], &cellY[first], &cellFeature[first], count,
+				maxSquaredDist, hits.data());
+
+			for (size_t h = 0; h < numHits; ++h) {
+				pairs.push_back({ entries[a].index, entries[first + hits[h]].index });
+			}
+		};
+
+		// A cell belongs to the chunk that contains its first entry
+		size_t firstCell = std::lower_bound(cellStarts.begin(), cellStarts.end(), lo) - cellStarts.begin();
+		size_t lastCell = std::lower_bound(cellStarts.begin(), cellStarts.end(), hi) - cellStarts.begin();
+
+		for (size_t c = firstCell; c < lastCell; ++c) {
+			uint64_t key = cellKeys[c];
+			size_t begin = cellStarts[c];
+			size_t end = (c + 1 < cellStarts.size()) ? cellStarts[c + 1] : entries.size();
+
+			uint64_t cx = key >> 32;
+			uint64_t cy = key & 0xFFFFFFFFull;
+
+			for (size_t a = begin; a + 1 < end; ++a) {
+				joinBlock(a, a + 1, end);
+			}
+
+			for (const auto& offset : forward) {
+				if (offset[1] < 0 && cy == 0) continue;
+				auto it = cells.find(cellKey(cx + offset[0], cy + offset[1]));
+				if (it == cells.end()) continue;
+
+				for (size_t a = begin; a < end; ++a) {
+					joinBlock(a, it->second.first, it->second.second);
+				}
+			}
+		}
+	};
+
+	runOnThreads(numChunks, joinChunk);
+	return concatBuffers(chunkPairs);
 };
 
-// Build neighbor graph: create NeighborSet for each instance
-std::vector<NeighborSet> NeighborGraph::buildNeighborGraph(
-	const std::vector<SpatialInstance>& instances,
+// Build CSR neighbor graph straight from the joined index pairs
+CSRGraph NeighborGraph::buildNeighborGraph(
+	const InstanceStore& instances,
 	double distanceThreshold) {
 		//////// TODO: Implement (3)//////////
 
 	// 1. Find all neighbor pairs
 	auto pairs = findNeighborPair(instances, distanceThreshold);
 
-	// 2. Map InstanceID to memory address for stable graph construction
-	std::unordered_map<InstanceID, const SpatialInstance*> ptrMap;
-	for (const auto& inst : instances) {
-		ptrMap[inst.id] = &inst;
+	// 2. Count degrees into the row offsets (each pair contributes to both endpoints)
+	size_t n = instances.size();
+	CSRGraph graph;
+	graph.offsets.assign(n + 1, 0);
+	for (const auto& p : pairs) {
+		++graph.offsets[p.first + 1];
+		++graph.offsets[p.second + 1];
 	}
-
-	// 3. Build Adjacency List
-	std::unordered_map<const SpatialInstance*, std::vector<const SpatialInstance*>> adjList;
-	// Initialize for all instances
-	for (const auto& inst : instances) {
-		adjList[&inst] = std::vector<const SpatialInstance*>();
+	for (size_t v = 0; v < n; ++v) {
+		graph.offsets[v + 1] += graph.offsets[v];
 	}
 
+	// 3. Scatter both directions of every edge into its row
+	graph.neighbors.resize(graph.offsets[n]);
+	std::vector<uint64_t> cursor(graph.offsets.begin(), graph.offsets.end() - 1);
 	for (const auto& p : pairs) {
-		const SpatialInstance* p1 = ptrMap[p.first.id];
-		const SpatialInstance* p2 = ptrMap[p.second.id];
-		if (p1 && p2) {
-			adjList[p1].push_back(p2);
-			adjList[p2].push_back(p1);
-		}
+		graph.neighbors[cursor[p.first]++] = p.second;
+		graph.neighbors[cursor[p.second]++] = p.first;
 	}
+	std::vector<std::pair<InstanceIndex, InstanceIndex>>().swap(pairs);
 
-	// 4. Construct NeighborSets
-	std::vector<NeighborSet> neighborSets;
-	neighborSets.reserve(instances.size());
-	for (const auto& inst : instances) {
-		NeighborSet ns;
-		ns.center = &inst;
-		ns.neighbors = adjList[&inst];
-		neighborSets.push_back(ns);
+	// 4. Sort every adjacency row so clique enumeration can intersect rows directly
+	for (size_t v = 0; v < n; ++v) {
+		std::sort(graph.neighbors.begin() + graph.offsets[v], graph.neighbors.begin() + graph.offsets[v + 1]);
 	}
 
-	return neighborSets;
-};
+	return graph;
+};
\ No newline at end of file
@@ -0,0 +1,75 @@
+/**
+ * @file participation_table.cpp
+ * @brief Implementation: Level-wise sparse superset-zeta transform
+ */
+
+#include "participation_table.h"
+#include <algorithm>
+
+template <size_t W>
+ParticipationTable<W>::ParticipationTable(const InstanceHashMap<W>& hashMap) {
+	using Level = std::unordered_map<ColocationMask<W>, FeatureInstances, FeatureBitsetHash>;
+
+	// Keys grouped by size
+	size_t maxSize = 0;
+	for (const auto& entry : hashMap) maxSize = std::max(maxSize, entry.first.count());
+	if (maxSize < 2) return;
+
+	std::vector<const typename InstanceHashMap<W>::value_type*> keysBySize;
+	keysBySize.reserve(hashMap.size());
+	for (const auto& entry : hashMap) keysBySize.push_back(&entry);
+	std::sort(keysBySize.begin(), keysBySize.end(),
+		[](const auto* a, const auto* b) { return a->first.count() > b->first.count(); });
+
+	Level current;
+	size_t nextKey = 0;
+	for (size_t k = maxSize; k >= 2; --k) {
+		// Keys of size k start from their own instances
+		for (; nextKey < keysBySize.size() && keysBySize[nextKey]->first.count() == k; ++nextKey) {
+			FeatureInstances& dst = current[keysBySize[nextKey]->first];
+			for (const auto& feature : keysBySize[nextKey]->second) {
+				dst[feature.first].unionWith(feature.second);
+			}
+		}
+
+		// Push each pattern's bitmaps into its size k - 1 subsets
+		Level next;
+		if (k > 2) {
+			for (const auto& entry : current) {
+				entry.first.forEach([&](size_t removed) {
+					ColocationMask<W> sub = entry.first;
+					sub.reset(removed);
+					FeatureInstances& dst = next[sub];
+					for (const auto& feature : entry.second) {
+						if (feature.first != removed) dst[feature.first].unionWith(feature.second);
+					}
+				});
+			}
+		}
+
+		// Level k is final: keep only the counts
+		for (const auto& entry : current) {
+			offsets.emplace(entry.first, static_cast<uint32_t>(counts.size()));
+			entry.first.forEach([&](size_t f) {
+				auto it = entry.second.find(static_cast<FeatureID>(f));
+				counts.push_back(it == entry.second.end() ? 0 : static_cast<uint32_t>(it->second.count()));
+			});
+		}
+		current.swap(next);
+	}
+};
+
+template <size_t W>
+const uint32_t* ParticipationTable<W>::find(const ColocationMask<W>& c) const {
+	auto it = offsets.find(c);
+	return (it == offsets.end()) ? nullptr : counts.data() + it->second;
+};
+
+// Mask widths used by the miner: 1, 2 and 4 words, then 16, 64, 256 and 1024 (see kMaxMaskWords)
+template class ParticipationTable<1>;
+template class ParticipationTable<2>;
+template class ParticipationTable<4>;
+template class ParticipationTable<16>;
+template class ParticipationTable<64>;
+template class ParticipationTable<256>;
+template class ParticipationTable<1024>;
@@ -0,0 +1,62 @@
+/**
+ * @file superset_index.cpp
+ * @brief Implementation: Per-feature posting lists for superset lookups
+ */
+
+#include "superset_index.h"
+
+template <size_t W>
+SupersetIndex<W>::SupersetIndex(const InstanceHashMap<W>& hashMap, size_t numFeatures) {
+	keys.reserve(hashMap.size());
+	instances.reserve(hashMap.size());
+	for (const auto& entry : hashMap) {
+		keys.push_back(entry.first);
+		instances.push_back(&entry.second);
+	}
+
+	// Count, prefix-sum, scatter (ordinals are visited ascending, so lists stay sorted)
+	offsets.assign(numFeatures + 1, 0);
+	for (const auto& mask : keys) {
+		mask.forEach([&](size_t f) { offsets[f + 1]++; });
+	}
+	for (size_t f = 0; f < numFeatures; ++f) offsets[f + 1] += offsets[f];
+
+	postings.resize(offsets[numFeatures]);
+	std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+	for (uint32_t ordinal = 0; ordinal < keys.size(); ++ordinal) {
+		keys[ordinal].forEach([&](size_t f) { postings[cursor[f]++] = ordinal; });
+	}
+};
+
+template <size_t W>
+void SupersetIndex<W>::findSupersets(const ColocationMask<W>& c, std::vector<uint32_t>& out, size_t excluded) const {
+	out.clear();
+	if (c.empty()) return;
+
+	// Rarest feature of c bounds the candidates; the mask test does the intersection
+	size_t rarest = 0;
+	uint32_t rarestLength = UINT32_MAX;
+	c.forEach([&](size_t f) {
+		uint32_t length = offsets[f + 1] - offsets[f];
+		if (length < rarestLength) {
+			rarestLength = length;
+			rarest = f;
+		}
+	});
+
+	for (uint32_t p = offsets[rarest]; p < offsets[rarest + 1]; ++p) {
+		uint32_t ordinal = postings[p];
+		if (c.isSubsetOf(keys[ordinal]) && (excluded == SIZE_MAX || !keys[ordinal].test(excluded))) {
+			out.push_back(ordinal);
+		}
+	}
+};
+
+// Mask widths used by the miner: 1, 2 and 4 words, then 16, 64, 256 and 1024 (see kMaxMaskWords)
+template class SupersetIndex<1>;
+template class SupersetIndex<2>;
+template class SupersetIndex<4>;
+template class SupersetIndex<16>;
+template class SupersetIndex<64>;
+template class SupersetIndex<256>;
+template class SupersetIndex<1024>;
@@ -0,0 +1,116 @@
+/**
+ * @file thread_pool.cpp
+ * @brief Implementation: Work-stealing thread pool
+ */
+
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace {
+	// Pool and worker index of the current thread (null outside any pool)
+	thread_local const WorkStealingPool* currentPool = nullptr;
+	thread_local size_t currentWorker = 0;
+}
+
+WorkStealingPool::WorkStealingPool(int numThreads) {
+	size_t count = (numThreads > 0) ? static_cast<size_t>(numThreads)
+		: std::max(1u, std::thread::hardware_concurrency());
+
+	queues.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	threads.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+	}
+}
+
+WorkStealingPool::~WorkStealingPool() {
+	{
+		std::lock_guard<std::mutex> lock(idleMutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+// Queue a task: onto the caller's own deque from inside a task, otherwise round-robin
+void WorkStealingPool::submit(Task task) {
+	size_t target = (currentPool == this) ? currentWorker
+		: nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+	pending.fetch_add(1, std::memory_order_acq_rel);
+	{
+		std::lock_guard<std::mutex> lock(queues[target]->mutex);
+		queues[target]->tasks.push_back(std::move(task));
+	}
+	queued.fetch_add(1, std::memory_order_acq_rel);
+
+	// Taking the idle lock orders this notify after any worker's predicate check
+	{
+		std::lock_guard<std::mutex> lock(idleMutex);
+	}
+	workAvailable.notify_one();
+}
+
+// Block until every submitted task (including nested submissions) has finished
+void WorkStealingPool::wait() {
+	std::unique_lock<std::mutex> lock(idleMutex);
+	allDone.wait(lock, [&] { return pending.load(std::memory_order_acquire) == 0; });
+}
+
+// Pop the newest task of the worker's own deque
+bool WorkStealingPool::popOwn(size_t workerId, Task& task) {
+	WorkerQueue& queue = *queues[workerId];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty()) return false;
+
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	queued.fetch_sub(1, std::memory_order_acq_rel);
+	return true;
+}
+
+// Steal the oldest task of another worker, scanning from the thief's right-hand neighbor
+bool WorkStealingPool::steal(size_t thiefId, Task& task) {
+	for (size_t offset = 1; offset < queues.size(); ++offset) {
+		WorkerQueue& queue = *queues[(thiefId + offset) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) continue;
+
+		task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		queued.fetch_sub(1, std::memory_order_acq_rel);
+		return true;
+	}
+	return false;
+}
+
+void WorkStealingPool::workerLoop(size_t workerId) {
+	currentPool = this;
+	currentWorker = workerId;
+
+	while (true) {
+		Task task;
+		if (popOwn(workerId, task) || steal(workerId, task)) {
+			task(workerId);
+			task = nullptr;
+
+			if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				std::lock_guard<std::mutex> lock(idleMutex);
+				allDone.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(idleMutex);
+		workAvailable.wait(lock, [&] {
+			return stopping || queued.load(std::memory_order_acquire) > 0;
+		});
+		if (stopping && queued.load(std::memory_order_acquire) == 0) return;
+	}
+}
\ No newline at end of file
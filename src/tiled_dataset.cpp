@@ -0,0 +1,267 @@
+/**
+ * @file tiled_dataset.cpp
+ * @brief Implementation: Batched ingest, tile spilling and tile-by-tile processing
+ */
+
+#include "tiled_dataset.h"
+#include "data_loader.h"
+#include "binary_io.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+	// One spilled point
+	struct SpillRecord {
+		double x;
+		double y;
+		uint32_t rank;          ///< Position among the instances of the same feature
+		FeatureID feature;      ///< First-seen feature ID (finalized when a tile is loaded)
+		uint16_t padding;
+	};
+	static_assert(sizeof(SpillRecord) == 24, "spill records are written as raw bytes");
+
+	// Cells per axis are capped so cell coordinates stay exact in a double and fit in 32 bits
+	constexpr double kMaxCellsPerAxis = double(1u << 30);
+
+	// Tiles of the first cut; later splits are binary (each open spill file holds a write buffer)
+	constexpr size_t kMaxInitialTiles = 256;
+
+	// Starting estimate of the processing bytes per tile point, before any tile is measured
+	constexpr double kInitialBytesPerPoint = 256.0;
+}
+
+TiledDataset::TiledDataset(const std::string& spillDirectory, size_t memoryBudgetBytes, double distanceThreshold)
+	: memoryBudget(memoryBudgetBytes),
+	batchBytes(std::min<size_t>(std::max<size_t>(memoryBudgetBytes / 16, size_t(64) << 10), size_t(64) << 20)),
+	distance(distanceThreshold),
+	bytesPerPoint(kInitialBytesPerPoint) {
+	std::error_code error;
+	std::filesystem::path base = spillDirectory.empty() ? std::filesystem::temp_directory_path(error) : std::filesystem::path(spillDirectory);
+	uint64_t unique = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+		static_cast<uint64_t>(reinterpret_cast<uintptr_t>(this));
+	directory = (base / ("colocation_tiles_" + hex64(unique))).string();
+	std::filesystem::create_directories(directory, error);
+	if (error) throw std::runtime_error("Cannot create spill directory: " + directory);
+};
+
+TiledDataset::~TiledDataset() {
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+};
+
+std::string TiledDataset::spillPath() {
+	return (std::filesystem::path(directory) / ("spill_" + std::to_string(nextFile++) + ".bin")).string();
+};
+
+uint32_t TiledDataset::cellOf(double value, double origin, uint32_t cells) const {
+	double cell = std::floor((value - origin) / cellSide);
+	if (!(cell > 0.0)) return 0;
+	return cell >= double(cells - 1) ? cells - 1 : static_cast<uint32_t>(cell);
+};
+
+uint64_t TiledDataset::maxTilePoints() const {
+	return std::max<uint64_t>(1, static_cast<uint64_t>(double(memoryBudget / 2) / bytesPerPoint));
+};
+
+// Spill every point in dataset order, assigning feature ranks and tracking the bounding box
+void TiledDataset::ingest(const std::string& filepath) {
+	pointsFile = spillPath();
+	std::ofstream out(pointsFile, std::ios::binary | std::ios::trunc);
+	if (!out) throw std::runtime_error("Cannot write spill file: " + pointsFile);
+
+	std::vector<uint32_t> nextRank;
+	std::vector<SpillRecord> records;
+	double minX = std::numeric_limits<double>::infinity(), minY = minX;
+	double maxX = -minX, maxY = -minX;
+	DataLoader::stream(filepath, batchBytes, dictionary, [&](const InstanceStore& batch) {
+		nextRank.resize(dictionary.size(), 0);
+		records.resize(batch.size());
+		for (size_t i = 0; i < batch.size(); ++i) {
+			FeatureID f = batch.featureId[i];
+			if (nextRank[f] == uint32_t(INT_MAX)) {
+				throw std::runtime_error("Too many instances of feature " + dictionary.name(f));
+			}
+			records[i] = { batch.x[i], batch.y[i], nextRank[f]++, f, 0 };
+			minX = std::min(minX, batch.x[i]);
+			maxX = std::max(maxX, batch.x[i]);
+			minY = std::min(minY, batch.y[i]);
+			maxY = std::max(maxY, batch.y[i]);
+		}
+		out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(SpillRecord)));
+		numInstances += batch.size();
+	});
+	out.close();
+	if (!out) throw std::runtime_error("Failed writing spill file: " + pointsFile);
+
+	// Ranks count the instances per first-seen ID; finalizing maps those IDs to name order
+	nextRank.resize(dictionary.size(), 0);
+	finalIds = dictionary.finalize();
+	counts.assign(dictionary.size(), 0);
+	for (size_t f = 0; f < finalIds.size(); ++f) {
+		counts[finalIds[f]] = static_cast<int>(nextRank[f]);
+	}
+	if (numInstances == 0) return;
+
+	// Cells are slightly wider than the distance so that rounding in the join's distance test
+	// and in the cell computation can never put two neighbors two cells apart
+	double extent = std::max(maxX - minX, maxY - minY);
+	double magnitude = std::max({ std::fabs(minX), std::fabs(maxX), std::fabs(minY), std::fabs(maxY) });
+	cellSide = std::max(distance * (1.0 + 1e-6) + magnitude * 1e-12, extent / kMaxCellsPerAxis);
+	if (!(cellSide > 0.0) || !std::isfinite(cellSide)) cellSide = 1.0;
+	originX = minX;
+	originY = minY;
+	cellsX = static_cast<uint32_t>(std::floor((maxX - minX) / cellSide)) + 1;
+	cellsY = static_cast<uint32_t>(std::floor((maxY - minY) / cellSide)) + 1;
+};
+
+std::vector<TiledDataset::TileRect> TiledDataset::distribute(const std::string& source,
+	const std::vector<uint32_t>& xBounds, const std::vector<uint32_t>& yBounds) {
+	size_t tilesX = xBounds.size() - 1;
+	size_t tilesY = yBounds.size() - 1;
+	std::vector<TileRect> tiles(tilesX * tilesY);
+	std::vector<std::ofstream> outputs(tiles.size());
+	for (size_t j = 0; j < tilesY; ++j) {
+		for (size_t i = 0; i < tilesX; ++i) {
+			TileRect& tile = tiles[j * tilesX + i];
+			tile.x0 = xBounds[i];
+			tile.x1 = xBounds[i + 1];
+			tile.y0 = yBounds[j];
+			tile.y1 = yBounds[j + 1];
+			tile.path = spillPath();
+			outputs[j * tilesX + i].open(tile.path, std::ios::binary | std::ios::trunc);
+			if (!outputs[j * tilesX + i]) throw std::runtime_error("Cannot write spill file: " + tile.path);
+		}
+	}
+
+	// Tiles of one axis whose core, widened by one cell on each side, holds cell c
+	auto haloRange = [](const std::vector<uint32_t>& bounds, uint32_t c, size_t& first, size_t& last) {
+		first = std::lower_bound(bounds.begin() + 1, bounds.end(), c) - (bounds.begin() + 1);
+		last = std::upper_bound(bounds.begin(), bounds.end() - 1, c + 1) - bounds.begin();
+		return last-- > first;
+	};
+
+	std::ifstream in(source, std::ios::binary);
+	if (!in) throw std::runtime_error("Cannot read spill file: " + source);
+	std::vector<SpillRecord> records(std::max<size_t>(1, batchBytes / sizeof(SpillRecord)));
+	while (in) {
+		in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(SpillRecord)));
+		size_t count = static_cast<size_t>(in.gcount()) / sizeof(SpillRecord);
+		for (size_t r = 0; r < count; ++r) {
+			uint32_t cx = cellOf(records[r].x, originX, cellsX);
+			uint32_t cy = cellOf(records[r].y, originY, cellsY);
+			size_t firstX, lastX, firstY, lastY;
+			if (!haloRange(xBounds, cx, firstX, lastX) || !haloRange(yBounds, cy, firstY, lastY)) continue;
+
+			for (size_t j = firstY; j <= lastY; ++j) {
+				for (size_t i = firstX; i <= lastX; ++i) {
+					TileRect& tile = tiles[j * tilesX + i];
+					outputs[j * tilesX + i].write(reinterpret_cast<const char*>(&records[r]), sizeof(SpillRecord));
+					++tile.points;
+					if (cx >= tile.x0 && cx < tile.x1 && cy >= tile.y0 && cy < tile.y1) ++tile.corePoints;
+				}
+			}
+		}
+	}
+
+	for (size_t t = 0; t < tiles.size(); ++t) {
+		outputs[t].close();
+		if (!outputs[t]) throw std::runtime_error("Failed writing spill file: " + tiles[t].path);
+	}
+	return tiles;
+};
+
+TiledDataset::Tile TiledDataset::loadTile(const TileRect& rect) const {
+	size_t n = static_cast<size_t>(rect.points);
+	Tile tile;
+	tile.instances.x.resize(n);
+	tile.instances.y.resize(n);
+	tile.instances.featureId.resize(n);
+	tile.instances.featureRank.resize(n);
+	tile.core.resize(n);
+
+	std::ifstream in(rect.path, std::ios::binary);
+	std::vector<SpillRecord> records(std::max<size_t>(1, batchBytes / sizeof(SpillRecord)));
+	size_t loaded = 0;
+	while (in && loaded < n) {
+		size_t want = std::min(records.size(), n - loaded);
+		in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(want * sizeof(SpillRecord)));
+		size_t count = static_cast<size_t>(in.gcount()) / sizeof(SpillRecord);
+		for (size_t r = 0; r < count; ++r, ++loaded) {
+			const SpillRecord& record = records[r];
+			uint32_t cx = cellOf(record.x, originX, cellsX);
+			uint32_t cy = cellOf(record.y, originY, cellsY);
+			tile.instances.x[loaded] = record.x;
+			tile.instances.y[loaded] = record.y;
+			tile.instances.featureId[loaded] = finalIds[record.feature];
+			tile.instances.featureRank[loaded] = record.rank;
+			tile.core[loaded] = (cx >= rect.x0 && cx < rect.x1 && cy >= rect.y0 && cy < rect.y1) ? 1 : 0;
+		}
+	}
+	if (loaded != n) throw std::runtime_error("Truncated spill file: " + rect.path);
+	return tile;
+};
+
+// First cut: a grid of about numInstances / maxTilePoints tiles (at most kMaxInitialTiles)
+// shaped like the bounding box. Then, depth first: split a tile over the budget in two
+// along its longer side, or load it, visit it and fold its measured cost into the estimate.
+void TiledDataset::forEachTile(const TileVisitor& visit) {
+	if (numInstances == 0) return;
+
+	uint64_t wanted = (numInstances + maxTilePoints() - 1) / maxTilePoints();
+	double target = double(std::min<uint64_t>(wanted, kMaxInitialTiles));
+	uint32_t tilesX = static_cast<uint32_t>(std::lround(std::sqrt(target * cellsX / cellsY)));
+	tilesX = std::max<uint32_t>(1, std::min<uint32_t>({ tilesX, cellsX, static_cast<uint32_t>(target) }));
+	uint32_t tilesY = static_cast<uint32_t>(target / tilesX);
+	tilesY = std::max<uint32_t>(1, std::min(tilesY, cellsY));
+
+	auto bounds = [](uint32_t cells, uint32_t parts) {
+		std::vector<uint32_t> cuts(parts + 1);
+		for (uint32_t p = 0; p <= parts; ++p) cuts[p] = static_cast<uint32_t>(uint64_t(cells) * p / parts);
+		return cuts;
+	};
+
+	std::error_code error;
+	std::vector<TileRect> pending = distribute(pointsFile, bounds(cellsX, tilesX), bounds(cellsY, tilesY));
+	std::filesystem::remove(pointsFile, error);
+	std::reverse(pending.begin(), pending.end());
+
+	while (!pending.empty()) {
+		TileRect rect = std::move(pending.back());
+		pending.pop_back();
+		if (rect.corePoints == 0) {
+			std::filesystem::remove(rect.path, error);
+			continue;
+		}
+
+		bool singleCell = rect.x1 - rect.x0 == 1 && rect.y1 - rect.y0 == 1;
+		if (rect.points > maxTilePoints() && !singleCell) {
+			std::vector<uint32_t> xBounds = { rect.x0, rect.x1 };
+			std::vector<uint32_t> yBounds = { rect.y0, rect.y1 };
+			if (rect.x1 - rect.x0 >= rect.y1 - rect.y0) xBounds.insert(xBounds.begin() + 1, rect.x0 + (rect.x1 - rect.x0) / 2);
+			else yBounds.insert(yBounds.begin() + 1, rect.y0 + (rect.y1 - rect.y0) / 2);
+
+			std::vector<TileRect> halves = distribute(rect.path, xBounds, yBounds);
+			std::filesystem::remove(rect.path, error);
+			pending.push_back(std::move(halves[1]));
+			pending.push_back(std::move(halves[0]));
+			++stats.splits;
+			continue;
+		}
+		if (rect.points > maxTilePoints()) ++stats.overBudgetTiles;
+
+		Tile tile = loadTile(rect);
+		std::filesystem::remove(rect.path, error);
+		size_t used = visit(tile);
+		bytesPerPoint = std::max(bytesPerPoint, double(used) / double(tile.instances.size()));
+		++stats.tiles;
+		stats.largestTile = std::max(stats.largestTile, tile.instances.size());
+	}
+};
@@ -19,15 +19,29 @@
 
 // Count instances per feature type and sort by frequency (ascending)
 std::map<FeatureType, int> countAndSortFeatures(
-	const std::vector<SpatialInstance>& instances) {
+	const InstanceStore& instances) {
 	//////// TODO: Implement (1)//////////
+	return countAndSortFeatures(instances.features, countFeaturesById(instances));
+};
+
+// Count instances per feature type from per-ID counts
+std::map<FeatureType, int> countAndSortFeatures(const FeatureDictionary& features, const std::vector<int>& countsById) {
 	std::map<FeatureType, int> counts;
-	for (const auto& instance : instances) {
-		counts[instance.type]++;
+	for (size_t f = 0; f < countsById.size(); ++f) {
+		counts[features.name(static_cast<FeatureID>(f))] = countsById[f];
 	}
 	return counts;
 };
 
+// Count instances per feature ID (index = FeatureID)
+std::vector<int> countFeaturesById(const InstanceStore& instances) {
+	std::vector<int> countsById(instances.features.size(), 0);
+	for (FeatureID f : instances.featureId) {
+		countsById[f]++;
+	}
+	return countsById;
+};
+
 // Calculate dispersion (delta) from feature distribution
 double calculateDirpersion(const std::map<FeatureType, int>& featureCount) {
 		//////// TODO: Implement (2)//////////
@@ -61,52 +75,102 @@ double calculateDirpersion(const std::map<FeatureType, int>& featureCount) {
     return std::sqrt(variance);
 };
 
-// Calculate rare intensity for each instance in a colocation
-std::unordered_map<FeatureType, double> calcRareIntensity(
-	Colocation c,
-	const std::map<FeatureType, int>& featureCounts,
+// Calculate rare intensity weights for every (f_min, f) pair once
+RareWeightTable buildRareWeightTable(
+	const std::vector<int>& featureCounts,
 	double delta) {
 		//////// TODO: Implement (11)//////////
-	std::unordered_map<FeatureType, double> intensityMap;
-	if (c.empty()) return intensityMap;
-
-	// 1. Find N(f_min)
-	// Initialize with first feature's count
-	int minCount = -1;
-	
-	for (const auto& f : c) {
-		if (featureCounts.find(f) != featureCounts.end()) {
-			int count = featureCounts.at(f);
-			if (minCount == -1 || count < minCount) {
-				minCount = count;
-			}
-		}
+	RareWeightTable table;
+
+	// Features sharing an instance count share their weights
+	std::vector<int> counts(featureCounts);
+	std::sort(counts.begin(), counts.end());
+	counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+	size_t numClasses = counts.size();
+	table.numClasses = numClasses;
+	table.countClass.reserve(featureCounts.size());
+	for (int count : featureCounts) {
+		table.countClass.push_back(static_cast<uint32_t>(
+			std::lower_bound(counts.begin(), counts.end(), count) - counts.begin()));
 	}
+	table.weights.assign(numClasses * numClasses, 1.0);   // RI defaults to 1 when undefined
 
-	if (minCount <= 0) return intensityMap; 
-
-	// 2. Calculate Rare Intensity (RI) and combined weight factor
+	// 1. Calculate Rare Intensity (RI) and combined weight factor
 	double sigmaSq2 = 2.0 * delta * delta;
 	if (sigmaSq2 == 0) sigmaSq2 = 1e-9; 
 
-	double logMin = std::log(static_cast<double>(minCount));
+	for (size_t minClass = 0; minClass < numClasses; ++minClass) {
+		// N(f_min)
+		int minCount = counts[minClass];
+		if (minCount <= 0) continue;
+		double logMin = std::log(static_cast<double>(minCount));
+
+		for (size_t countClass = 0; countClass < numClasses; ++countClass) {
+			int count = counts[countClass];
+			if (count <= 0) continue;
+
+			// Step 2: Calculate Delta_log
+			double logCount = std::log(static_cast<double>(count));
+			double deltaLog = logCount - logMin;
 
-	for (const auto& f : c) {
-		if (featureCounts.find(f) != featureCounts.end()) {
-			int count = featureCounts.at(f);
-			if (count > 0) {
-				// Step 2: Calculate Delta_log
-				double logCount = std::log(static_cast<double>(count));
-				double deltaLog = logCount - logMin;
+			// Step 3: Calculate RI
+			double ri = std::exp(-(deltaLog * deltaLog) / sigmaSq2);
 
-				// Step 3: Calculate RI
-				double ri = std::exp(-(deltaLog * deltaLog) / sigmaSq2);
+			// Step 4: W_log = 1 / RI
+			table.weights[minClass * numClasses + countClass] = (ri > 1e-9) ? 1.0 / ri : 0.0;
+		}
+	}
 
-				// Store result (Mapping FeatureType -> RI)
-				intensityMap[f] = ri;
-			}
+	return table;
+};
+
+// Count, for every ordered feature pair, the instances of the first with a neighbor of the second
+PairwiseParticipation buildPairwiseParticipation(
+	const CSRGraph& graph,
+	const InstanceStore& instances) {
+	PairwiseParticipation table;
+	table.reset(instances.features.size());
+	accumulatePairwiseParticipation(graph, instances, nullptr, table);
+	return table;
+};
+
+// Add the counts of the counted instances to table
+void accumulatePairwiseParticipation(
+	const CSRGraph& graph,
+	const InstanceStore& instances,
+	const uint8_t* counted,
+	PairwiseParticipation& table) {
+	if (table.empty()) return;
+	size_t numFeatures = table.numFeatures;
+
+	// lastSeen[fj] == v + 1 once v has been counted for fj (one sweep of the CSR rows)
+	std::vector<size_t> lastSeen(numFeatures, 0);
+	for (size_t v = 0; v < graph.numNodes(); ++v) {
+		if (counted && !counted[v]) continue;
+		uint32_t* row = table.counts.data() + instances.featureId[v] * numFeatures;
+		for (const InstanceIndex* n = graph.begin(v); n != graph.end(v); ++n) {
+			FeatureID fj = instances.featureId[*n];
+			if (lastSeen[fj] == v + 1) continue;
+			lastSeen[fj] = v + 1;
+			row[fj]++;
 		}
 	}
+};
+
+// Feature names of a colocation mask, in ascending name order
+template <size_t W>
+Colocation toColocation(const ColocationMask<W>& c, const FeatureDictionary& features) {
+	Colocation names;
+	names.reserve(c.count());
+	c.forEach([&](size_t f) { names.push_back(features.name(static_cast<FeatureID>(f))); });
+	return names;
+};
 
-	return intensityMap;
-};
\ No newline at end of file
+// Mask widths used by main: 1, 2 and 4 words, then 16, 64, 256 and 1024 (see kMaxMaskWords)
+template Colocation toColocation<1>(const ColocationMask<1>&, const FeatureDictionary&);
+template Colocation toColocation<2>(const ColocationMask<2>&, const FeatureDictionary&);
+template Colocation toColocation<4>(const ColocationMask<4>&, const FeatureDictionary&);
+template Colocation toColocation<16>(const ColocationMask<16>&, const FeatureDictionary&);
+template Colocation toColocation<64>(const ColocationMask<64>&, const FeatureDictionary&);
+template Colocation toColocation<256>(const ColocationMask<256>&, const FeatureDictionary&);
+template Colocation toColocation<1024>(const ColocationMask<1024>&, const FeatureDictionary&);
\ No newline at end of file